@@ -15,10 +15,18 @@
  *
  *   A thread–mapping plan is demonstrated by assigning specific cores to 
  *   insertion and sorting threads.
+ *
+ *   Nodes come from a node arena instead of one new/delete each: every
+ *   insertion thread carves its nodes out of its own slab of cache-line
+ *   aligned chunks (optionally bound to the thread's NUMA node), and a
+ *   whole list is released in one call.
  ********************************************************************/
 
 #include <pthread.h>
 #include <sched.h>      // For CPU affinity functions
+#include <sys/mman.h>   // For mmap (NUMA-local chunks)
+#include <sys/syscall.h>
+#include <unistd.h>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
@@ -38,6 +46,133 @@ struct Node
 
 void setAffinity(pthread_t thread, int coreId);
 
+// -----------------------------
+// Node Arena
+// -----------------------------
+// Nodes are handed out of NODE_CHUNK_BYTES chunks, a cache line of header
+// (the link to the slab's previous chunk) then the nodes. Each inserting
+// thread owns one slab, the chain of chunks it allocates from, so it takes
+// no lock and calls the allocator once per chunk rather than once per node.
+// With numaLocal the chunks are mapped with the MPOL_LOCAL policy: their
+// pages are placed on the NUMA node of the thread that fills them, whatever
+// the process-wide policy. Releasing the arena frees every node of every slab
+// at once, without walking the lists.
+#ifndef MPOL_LOCAL
+#define MPOL_LOCAL 4
+#endif
+
+const int CACHE_LINE = 64;
+const int NODE_CHUNK_BYTES = 64 * 1024;  // A multiple of the page size (mmap'ed when NUMA-local)
+const int NODES_PER_CHUNK = (NODE_CHUNK_BYTES - CACHE_LINE) / sizeof(Node);
+
+// One thread's allocator, alone on its cache line.
+struct alignas(CACHE_LINE) NodeSlab 
+{
+    char* chunks;   // Newest chunk (NULL before the first); each links to the previous one
+    Node* nodes;    // Nodes of the newest chunk
+    int used;       // Nodes handed out of it
+};
+
+struct NodeArena 
+{
+    int numSlabs;
+    bool numaLocal;
+    NodeSlab* slabs;
+};
+
+// Prepares an arena with one slab per inserting thread; chunks are only
+// allocated as nodes are requested.
+void arenaCreate(NodeArena* arena, int numSlabs, bool numaLocal) 
+{
+    arena->numSlabs = numSlabs;
+    arena->numaLocal = numaLocal;
+
+    if (posix_memalign((void**) &arena->slabs, CACHE_LINE, numSlabs * sizeof(NodeSlab)) != 0) 
+    {
+        cerr << "Error allocating the node arena" << endl;
+
+        exit(-1);
+    }
+
+    for (int i = 0; i < numSlabs; i++) 
+    {
+        arena->slabs[i].chunks = NULL;
+        arena->slabs[i].nodes = NULL;
+        arena->slabs[i].used = NODES_PER_CHUNK;
+    }
+}
+
+// Adds a chunk to the slab, allocated by (and so first touched from) the
+// calling thread.
+void arenaGrow(NodeArena* arena, NodeSlab* slab) 
+{
+    void* chunk;
+
+    if (arena->numaLocal) 
+    {
+        chunk = mmap(NULL, NODE_CHUNK_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (chunk == MAP_FAILED) 
+        {
+            cerr << "Error mapping a node chunk" << endl;
+
+            exit(-1);
+        }
+
+        // Best effort: without NUMA support the pages are placed as usual.
+        syscall(SYS_mbind, chunk, NODE_CHUNK_BYTES, MPOL_LOCAL, NULL, 0, 0);
+    }
+    else if (posix_memalign(&chunk, CACHE_LINE, NODE_CHUNK_BYTES) != 0) 
+    {
+        cerr << "Error allocating a node chunk" << endl;
+
+        exit(-1);
+    }
+
+    *(char**) chunk = slab->chunks;
+
+    slab->chunks = (char*) chunk;
+    slab->nodes = (Node*) ((char*) chunk + CACHE_LINE);
+    slab->used = 0;
+}
+
+// A node from the given slab. Only the slab's owner thread may call this.
+inline Node* arenaAllocate(NodeArena* arena, int slabIndex) 
+{
+    NodeSlab* slab = &arena->slabs[slabIndex];
+
+    if (slab->used == NODES_PER_CHUNK)
+        arenaGrow(arena, slab);
+
+    return &slab->nodes[slab->used++];
+}
+
+// Frees every node allocated from the arena: one call per chunk, none per node.
+void arenaRelease(NodeArena* arena) 
+{
+    for (int i = 0; i < arena->numSlabs; i++) 
+    {
+        char* chunk = arena->slabs[i].chunks;
+
+        while (chunk) 
+        {
+            char* previous = *(char**) chunk;
+
+            if (arena->numaLocal)
+                munmap(chunk, NODE_CHUNK_BYTES);
+            else
+                free(chunk);
+
+            chunk = previous;
+        }
+    }
+
+    free(arena->slabs);
+
+    arena->slabs = NULL;
+    arena->numSlabs = 0;
+}
+
 // -----------------------------
 // Serial Version Functions
 // -----------------------------
@@ -49,12 +184,13 @@ void readRollNumbers(FILE* inputFile, int* Numbers, int num)
         fscanf(inputFile, "%d", &Numbers[i]);
 }
 
-// (ii) Inserting the numbers into a linked list (appending at the end).
-void addRollNumbersToList(Node** head, int* Numbers, int num) 
+// (ii) Inserting the numbers into a linked list (appending at the end), with
+// the nodes taken from the arena's first slab.
+void addRollNumbersToList(Node** head, int* Numbers, int num, NodeArena* arena) 
 {
     for (int i = 0; i < num; i++) 
     {
-        Node* newNode = new Node;
+        Node* newNode = arenaAllocate(arena, 0);
     
         newNode->data = Numbers[i];
         newNode->next = NULL;
@@ -189,16 +325,25 @@ struct ParallelInsertData
     int* numbers;
     int start;
     int end;  // end index (non-inclusive)
+    NodeArena* arena;
+    int slab;  // This thread's slab of the arena
+    int core;  // Core the thread pins itself to (-1: not pinned)
 };
 
 // Thread function: Insert a subset of numbers into the global linked list.
+// Nodes come from the thread's own slab: only the list head is locked.
+// The thread pins itself before its first allocation, so that the chunks it
+// faults in land on the NUMA node of its core.
 void* addRollNumbersToListParallel(void* arg) 
 {
     ParallelInsertData* data = (ParallelInsertData*) arg;
 
+    if (data->core >= 0)
+        setAffinity(pthread_self(), data->core);  // Setting CPU affinity as in your original code.
+
     for (int i = data->start; i < data->end; i++) 
     {
-         Node* newNode = new Node;
+         Node* newNode = arenaAllocate(data->arena, data->slab);
          newNode->data = data->numbers[i];
     
          // For speed, insert at the head.
@@ -428,27 +573,22 @@ void runPerformanceTests(const char* filename, int num, bool setAffinityFlag)
     
     // Building linked list using serial insertion.
     Node* serialHead = NULL;
+
+    NodeArena serialArena;
+
+    arenaCreate(&serialArena, 1, false);
     
-    addRollNumbersToList(&serialHead, numbers, num);
+    addRollNumbersToList(&serialHead, numbers, num, &serialArena);
     
-    // Sorting the list using serial quick sort.
-    Node* sortedSerial = quickSort(serialHead);
+    // Sorting the list using serial quick sort (it only relinks the nodes).
+    quickSort(serialHead);
     
     clock_t endSerial = clock();
     
     double serialTime = double(endSerial - startSerial) / CLOCKS_PER_SEC;
     
     // Freeing the serial sorted list.
-    Node* temp = sortedSerial;
-    
-    while (temp) 
-    {
-        Node* next = temp->next;
-    
-        delete temp;
-    
-        temp = next;
-    }
+    arenaRelease(&serialArena);
     
     // ----------- Parallel Version Timing -----------
     // Resetting the global linked list for parallel insertion.
@@ -462,6 +602,12 @@ void runPerformanceTests(const char* filename, int num, bool setAffinityFlag)
     ParallelInsertData insertData[numThreads];
     
     int chunkSize = num / numThreads;
+
+    // One slab per insertion thread; pinned threads also get their chunks
+    // on their own NUMA node.
+    NodeArena parallelArena;
+
+    arenaCreate(&parallelArena, numThreads, setAffinityFlag);
     
     for (int i = 0; i < numThreads; i++) 
     {
@@ -472,11 +618,12 @@ void runPerformanceTests(const char* filename, int num, bool setAffinityFlag)
             insertData[i].end = num;
         else
             insertData[i].end = (i + 1) * chunkSize;
+
+        insertData[i].arena = &parallelArena;
+        insertData[i].slab = i;
+        insertData[i].core = setAffinityFlag ? i : -1;
         
         pthread_create(&insertThreads[i], NULL, addRollNumbersToListParallel, (void*) &insertData[i]);
-    
-        if (setAffinityFlag)
-            setAffinity(insertThreads[i], i);       // Setting CPU affinity as in your original code.
     }
     
     // Wait for all insertion threads to complete.
@@ -493,27 +640,14 @@ void runPerformanceTests(const char* filename, int num, bool setAffinityFlag)
     if (setAffinityFlag)
         setAffinity(sortThread, 0); // Binding the sorting thread to a specific core (as in your code).
     
-    void* ret;
-    
-    pthread_join(sortThread, &ret);
-    
-    Node* sortedParallel = (Node*) ret;
+    pthread_join(sortThread, NULL);
     
     clock_t endParallel = clock();
     
     double parallelTime = double(endParallel - startParallel) / CLOCKS_PER_SEC;
     
     // Freeing the parallel sorted list.
-    temp = sortedParallel;
-    
-    while (temp) 
-    {
-        Node* next = temp->next;
-    
-        delete temp;
-    
-        temp = next;
-    }
+    arenaRelease(&parallelArena);
     
     // Freeing the numbers array.
     delete[] numbers;
@@ -550,7 +684,11 @@ int main()
     // ------------------ Serial Version ------------------
     Node* serialHead = NULL;
 
-    addRollNumbersToList(&serialHead, numbers, num);
+    NodeArena serialArena;
+
+    arenaCreate(&serialArena, 1, false);
+
+    addRollNumbersToList(&serialHead, numbers, num, &serialArena);
     
     // Sorting the list using the serial quick sort.
     Node* sortedSerial = quickSort(serialHead);
@@ -566,15 +704,7 @@ int main()
     cout << endl;
     
     // Freeing the serial sorted list.
-    temp = sortedSerial;
-
-    while (temp) {
-         Node* next = temp->next;
-    
-         delete temp;
-    
-         temp = next;
-    }
+    arenaRelease(&serialArena);
 
     cout << "\n>> Serial version completed" << endl;
     
@@ -590,6 +720,11 @@ int main()
     ParallelInsertData insertData[numThreads];
     
     int chunkSize = num / numThreads;
+
+    // One slab per insertion thread, on the NUMA node of its core.
+    NodeArena parallelArena;
+
+    arenaCreate(&parallelArena, numThreads, true);
     
     for (int i = 0; i < numThreads; i++) 
     {
@@ -600,11 +735,14 @@ int main()
               insertData[i].end = num;
          else
               insertData[i].end = (i + 1) * chunkSize;
+
+         insertData[i].arena = &parallelArena;
+         insertData[i].slab = i;
+
+         // Mapping each insertion thread to a specific core (e.g., core = i).
+         insertData[i].core = i;
     
          pthread_create(&insertThreads[i], NULL, addRollNumbersToListParallel, (void*) &insertData[i]);
-    
-         // Mapping each insertion thread to a specific core (e.g., core = i).
-         setAffinity(insertThreads[i], i);
     }
 
     for (int i = 0; i < numThreads; i++)
@@ -638,16 +776,7 @@ int main()
     cout << endl;
     
     // Freeing the parallel sorted list.
-    temp = sortedParallel;
-    
-    while (temp) 
-    {
-         Node* next = temp->next;
-         
-         delete temp;
-         
-         temp = next;
-    }
+    arenaRelease(&parallelArena);
 
     cout << "\n>> Parallel version completed" << endl;
     
@@ -0,0 +1,451 @@
+/********************************************************************
+ * Library of the matrix kernels: the kernel engine behind matrixKernels.h,
+ * on the kernels of matrixKernelsInternal.h. Only the functions declared in
+ * matrixKernels.h have external linkage.
+ *
+ * Build:       g++ -std=c++11 -O2 -pthread -c matrixKernels.cpp -o matrixKernels.o
+ *              and link matrixKernels.o with -pthread into the client.
+ ********************************************************************/
+
+#include "matrixKernels.h"
+#include "matrixKernelsInternal.h"
+
+// -----------------------------
+// Kernel Engine (asynchronous jobs)
+// -----------------------------
+// The library interface (matrixKernels.h). Submitted jobs wait in a FIFO;
+// one dispatcher thread owns the engine's pool (poolRun serves one job at a
+// time) and repeatedly takes:
+//   a large job (ENGINE_BATCH_ELEMENTS or more elements): run alone, with the
+//     usual parallel launchers over all the workers;
+//   otherwise every small job queued, up to ENGINE_MAX_BATCH: one pool run
+//     with a task per job; a task runs its whole job on the worker through
+//     the same launchers on the worker's inline pool, so a batch of small
+//     jobs from many callers costs one wake-up of the pool.
+// Status changes happen under the engine mutex and are broadcast on
+// jobChanged, which the waiters share.
+
+struct KernelJob 
+{
+    KernelJobType type;
+    const double* input;
+    double* output;
+    int n;
+    long count;                  // Elements of a log job
+
+    KernelJobStatus status;
+    bool failed;                 // Set by the thread that ran it (out of memory)
+    LogDeterminant determinant;
+    MatrixReduction<double> reduction;
+
+    KernelEngine* engine;
+    KernelJob* next;             // Next queued job
+};
+
+struct KernelEngine 
+{
+    WorkerPool pool;
+    WorkerPool* inlinePools;     // Per worker, for batched small jobs
+    Distribution* dists;         // Per worker (inline pools), then one for large jobs
+
+    KernelJob* head;             // Queued jobs, FIFO
+    KernelJob* tail;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t jobQueued;    // Signalled to the dispatcher
+    pthread_cond_t jobChanged;   // Broadcast when a job finishes or is cancelled
+    bool shutdown;
+
+    pthread_t dispatcher;
+};
+
+namespace 
+{
+
+// Jobs below this many elements (512 KiB of doubles) are batched.
+const long ENGINE_BATCH_ELEMENTS = 1L << 16;
+
+// Most small jobs in one batch.
+const int ENGINE_MAX_BATCH = 256;
+
+// For a batch of small jobs
+struct EngineTaskData 
+{
+    KernelJob* job;
+    WorkerPool* inlinePool;      // Of the worker the task lands on
+    Distribution* dist;
+};
+
+long jobElements(const KernelJob* job)
+{
+    return (job->type == JOB_LOG) ? job->count : (long) job->n * job->n;
+}
+
+// Runs a job with the parallel launchers on the given pool. The arguments
+// were checked by submitJob, so the launchers' own checks (which exit) always
+// pass; an allocation failure marks the job failed.
+void runKernelJob(KernelJob* job, WorkerPool* pool, Distribution* dist)
+{
+    try 
+    {
+        switch (job->type) 
+        {
+            case JOB_TRANSPOSE: parallelTranspose(pool, job->input, job->output, job->n, OP_IDENTITY, dist); break;
+            case JOB_LOG: parallelLogRange(pool, job->input, job->output, job->count, LOG_EXACT, dist); break;
+            case JOB_DETERMINANT: job->determinant = logDeterminant(pool, job->input, job->n); break;
+            case JOB_REDUCE: job->reduction = parallelReduce(pool, job->input, job->n, dist); break;
+        }
+    }
+    catch (const bad_alloc&) 
+    {
+        job->failed = true;
+    }
+}
+
+// Thread function for one job of a batch.
+void* engineTaskThread(void* arg) 
+{
+    EngineTaskData* data = (EngineTaskData*) arg;
+
+    runKernelJob(data->job, data->inlinePool, data->dist);
+
+    return NULL;
+}
+
+// Marks the jobs done (or failed) and wakes their waiters.
+void finishJobs(KernelEngine* engine, KernelJob** jobs, int count)
+{
+    pthread_mutex_lock(&engine->mutex);
+
+    for (int j = 0; j < count; j++)
+        jobs[j]->status = jobs[j]->failed ? JOB_FAILED : JOB_DONE;
+
+    pthread_cond_broadcast(&engine->jobChanged);
+    pthread_mutex_unlock(&engine->mutex);
+}
+
+// Thread function of the dispatcher.
+void* engineDispatchThread(void* arg) 
+{
+    KernelEngine* engine = (KernelEngine*) arg;
+
+    int numThreads = engine->pool.numThreads;
+
+    KernelJob** batch = new KernelJob*[ENGINE_MAX_BATCH];
+    EngineTaskData* taskData = new EngineTaskData[ENGINE_MAX_BATCH];
+
+    while (true) 
+    {
+        pthread_mutex_lock(&engine->mutex);
+
+        while (engine->head == NULL && !engine->shutdown)
+            pthread_cond_wait(&engine->jobQueued, &engine->mutex);
+
+        if (engine->head == NULL) 
+        {
+            pthread_mutex_unlock(&engine->mutex);
+
+            break;
+        }
+
+        // A large job at the head runs alone; else the small jobs are
+        // unlinked from anywhere in the queue (the large ones keep their order).
+        int count = 0;
+
+        if (jobElements(engine->head) >= ENGINE_BATCH_ELEMENTS) 
+        {
+            batch[count++] = engine->head;
+            engine->head = engine->head->next;
+        }
+        else 
+        {
+            KernelJob** link = &engine->head;
+
+            while (*link != NULL && count < ENGINE_MAX_BATCH) 
+            {
+                if (jobElements(*link) < ENGINE_BATCH_ELEMENTS) 
+                {
+                    batch[count++] = *link;
+                    *link = (*link)->next;
+                }
+                else
+                    link = &(*link)->next;
+            }
+        }
+
+        engine->tail = NULL;
+
+        for (KernelJob* job = engine->head; job != NULL; job = job->next)
+            engine->tail = job;
+
+        for (int j = 0; j < count; j++)
+            batch[j]->status = JOB_RUNNING;
+
+        pthread_mutex_unlock(&engine->mutex);
+
+        if (jobElements(batch[0]) >= ENGINE_BATCH_ELEMENTS) 
+        {
+            runKernelJob(batch[0], &engine->pool, &engine->dists[numThreads]);
+        }
+        else 
+        {
+            // Task j runs on worker j % numThreads (see the pool).
+            for (int j = 0; j < count; j++) 
+            {
+                taskData[j].job = batch[j];
+                taskData[j].inlinePool = &engine->inlinePools[j % numThreads];
+                taskData[j].dist = &engine->dists[j % numThreads];
+            }
+
+            poolRun(&engine->pool, engineTaskThread, taskData, sizeof(EngineTaskData), count);
+        }
+
+        finishJobs(engine, batch, count);
+    }
+
+    delete[] batch;
+    delete[] taskData;
+
+    return NULL;
+}
+
+// NULL, before anything is queued, for arguments a launcher would reject:
+// no engine or buffer, an empty job, or a transpose onto its own input.
+KernelJob* submitJob(KernelEngine* engine, KernelJobType type, const double* input, double* output, int n, long count)
+{
+    bool hasOutput = (type == JOB_TRANSPOSE || type == JOB_LOG);
+
+    if (engine == NULL || input == NULL || (hasOutput && output == NULL))
+        return NULL;
+
+    if ((type == JOB_LOG) ? count <= 0 : n <= 0)
+        return NULL;
+
+    if (type == JOB_TRANSPOSE && input == output)
+        return NULL;
+
+    KernelJob* job = new (nothrow) KernelJob;
+
+    if (job == NULL)
+        return NULL;
+
+    job->type = type;
+    job->input = input;
+    job->output = output;
+    job->n = n;
+    job->count = count;
+    job->engine = engine;
+    job->next = NULL;
+
+    job->status = JOB_QUEUED;
+    job->failed = false;
+
+    pthread_mutex_lock(&engine->mutex);
+
+    if (engine->tail != NULL)
+        engine->tail->next = job;
+    else
+        engine->head = job;
+
+    engine->tail = job;
+
+    pthread_cond_signal(&engine->jobQueued);
+    pthread_mutex_unlock(&engine->mutex);
+
+    return job;
+}
+
+// Frees an engine whose dispatcher has stopped (or never started).
+void engineFree(KernelEngine* engine)
+{
+    pthread_mutex_destroy(&engine->mutex);
+    pthread_cond_destroy(&engine->jobQueued);
+    pthread_cond_destroy(&engine->jobChanged);
+
+    poolDestroy(&engine->pool);
+
+    for (int w = 0; w < engine->pool.numThreads; w++)
+        poolDestroy(&engine->inlinePools[w]);
+
+    delete[] engine->inlinePools;
+    delete[] engine->dists;
+    delete engine;
+}
+
+} // namespace
+
+KernelEngine* engineCreate(int numThreads)
+{
+    if (numThreads < 1)
+        return NULL;
+
+    KernelEngine* engine = new KernelEngine;
+
+    if (!poolTryCreate(&engine->pool, numThreads, PIN_NONE)) 
+    {
+        delete engine;
+
+        return NULL;
+    }
+
+    engine->inlinePools = new WorkerPool[numThreads];
+    engine->dists = new Distribution[numThreads + 1];
+
+    for (int w = 0; w < numThreads; w++)
+        poolCreateInline(&engine->inlinePools[w]);
+
+    for (int d = 0; d <= numThreads; d++)
+        setDistribution(&engine->dists[d], DIST_BLOCK, DEFAULT_DIST_CHUNK);
+
+    engine->head = NULL;
+    engine->tail = NULL;
+    engine->shutdown = false;
+
+    pthread_mutex_init(&engine->mutex, NULL);
+    pthread_cond_init(&engine->jobQueued, NULL);
+    pthread_cond_init(&engine->jobChanged, NULL);
+
+    if (pthread_create(&engine->dispatcher, NULL, engineDispatchThread, (void*) engine) != 0) 
+    {
+        engineFree(engine);
+
+        return NULL;
+    }
+
+    return engine;
+}
+
+// Every job has been released (so none is queued or running).
+void engineDestroy(KernelEngine* engine)
+{
+    pthread_mutex_lock(&engine->mutex);
+
+    engine->shutdown = true;
+
+    pthread_cond_signal(&engine->jobQueued);
+    pthread_mutex_unlock(&engine->mutex);
+
+    pthread_join(engine->dispatcher, NULL);
+
+    engineFree(engine);
+}
+
+KernelJob* submitTranspose(KernelEngine* engine, const double* input, double* output, int n)
+{
+    return submitJob(engine, JOB_TRANSPOSE, input, output, n, 0);
+}
+
+KernelJob* submitLog(KernelEngine* engine, const double* input, double* output, long count)
+{
+    return submitJob(engine, JOB_LOG, input, output, 0, count);
+}
+
+KernelJob* submitDeterminant(KernelEngine* engine, const double* matrix, int n)
+{
+    return submitJob(engine, JOB_DETERMINANT, matrix, NULL, n, 0);
+}
+
+KernelJob* submitReduce(KernelEngine* engine, const double* matrix, int n)
+{
+    return submitJob(engine, JOB_REDUCE, matrix, NULL, n, 0);
+}
+
+bool jobCancel(KernelJob* job)
+{
+    KernelEngine* engine = job->engine;
+
+    pthread_mutex_lock(&engine->mutex);
+
+    bool cancelled = (job->status == JOB_QUEUED);
+
+    if (cancelled) 
+    {
+        KernelJob** link = &engine->head;
+        KernelJob* previous = NULL;
+
+        while (*link != job) 
+        {
+            previous = *link;
+            link = &(*link)->next;
+        }
+
+        *link = job->next;
+
+        if (engine->tail == job)
+            engine->tail = previous;
+
+        job->status = JOB_CANCELLED;
+
+        pthread_cond_broadcast(&engine->jobChanged);
+    }
+
+    pthread_mutex_unlock(&engine->mutex);
+
+    return cancelled;
+}
+
+KernelJobStatus jobStatus(KernelJob* job)
+{
+    pthread_mutex_lock(&job->engine->mutex);
+
+    KernelJobStatus status = job->status;
+
+    pthread_mutex_unlock(&job->engine->mutex);
+
+    return status;
+}
+
+KernelJobStatus jobWait(KernelJob* job)
+{
+    KernelEngine* engine = job->engine;
+
+    pthread_mutex_lock(&engine->mutex);
+
+    while (job->status == JOB_QUEUED || job->status == JOB_RUNNING)
+        pthread_cond_wait(&engine->jobChanged, &engine->mutex);
+
+    KernelJobStatus status = job->status;
+
+    pthread_mutex_unlock(&engine->mutex);
+
+    return status;
+}
+
+// A cancelled or failed job, or one that is not a determinant job, has no
+// result: sign 0, log|det| NaN.
+LogDeterminant jobDeterminant(KernelJob* job)
+{
+    if (job->type != JOB_DETERMINANT || jobWait(job) != JOB_DONE) 
+    {
+        LogDeterminant none = { 0, NAN };
+
+        return none;
+    }
+
+    return job->determinant;
+}
+
+// A cancelled or failed job, or one that is not a reduce job, has no
+// result: every field NaN.
+MatrixReduction<double> jobReduction(KernelJob* job)
+{
+    if (job->type != JOB_REDUCE || jobWait(job) != JOB_DONE) 
+    {
+        MatrixReduction<double> none = { NAN, NAN, NAN, NAN, NAN };
+
+        return none;
+    }
+
+    return job->reduction;
+}
+
+void jobRelease(KernelJob* job)
+{
+    if (job == NULL)
+        return;
+
+    jobCancel(job);
+    jobWait(job);
+
+    delete job;
+}
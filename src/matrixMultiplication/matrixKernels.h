@@ -0,0 +1,91 @@
+/********************************************************************
+ * Library interface of the matrix kernels (matrixKernels.cpp).
+ *
+ * Build:       g++ -std=c++11 -O2 -pthread -c matrixKernels.cpp -o matrixKernels.o
+ *              and link matrixKernels.o with -pthread into the client. The
+ *              object exports only the functions declared here.
+ *
+ * Usage:       A KernelEngine owns a worker pool. Any number of client
+ *              threads submit jobs on double-precision, row-major buffers
+ *              and get a KernelJob back, a future: jobWait blocks until the
+ *              job has run or was cancelled, and the typed accessors
+ *              (jobDeterminant, jobReduction) return its result. The
+ *              buffers must stay valid until the job is finished.
+ *              Large jobs run alone, split over all the workers; small jobs
+ *              queued together (from any callers) are batched into one pool
+ *              run, one job per worker. A job still queued can be cancelled;
+ *              one already running completes. The library never exits the
+ *              process: invalid arguments give NULL, and a job that runs
+ *              out of memory ends as JOB_FAILED.
+ ********************************************************************/
+
+#ifndef MATRIX_KERNELS_H
+#define MATRIX_KERNELS_H
+
+// Determinant kept in log space so that large matrices do not overflow:
+// det = sign * exp(logAbs).
+struct LogDeterminant 
+{
+    int sign;       // -1, +1, or 0 for a singular matrix
+    double logAbs;  // log|det| (-INFINITY for a singular matrix)
+};
+
+// Result of a whole-matrix reduction.
+template <typename T>
+struct MatrixReduction 
+{
+    double sum;
+    double frobenius;     // sqrt of the sum of squares
+    double trace;
+    T min, max;
+};
+
+enum KernelJobType { JOB_TRANSPOSE, JOB_LOG, JOB_DETERMINANT, JOB_REDUCE };
+
+// JOB_FAILED: the job ran out of memory; it has no result.
+enum KernelJobStatus { JOB_QUEUED, JOB_RUNNING, JOB_DONE, JOB_CANCELLED, JOB_FAILED };
+
+struct KernelEngine;
+struct KernelJob;
+
+// Starts an engine with numThreads (unpinned) workers; NULL if numThreads < 1
+// or the threads cannot be created. Every job must be released before
+// engineDestroy.
+KernelEngine* engineCreate(int numThreads);
+void engineDestroy(KernelEngine* engine);
+
+// Each submit returns NULL, and queues nothing, for a NULL engine or buffer,
+// n or count < 1, or (transpose) output == input.
+
+// output = inputᵀ of an n×n matrix.
+KernelJob* submitTranspose(KernelEngine* engine, const double* input, double* output, int n);
+
+// output = log(input) element-wise, count elements (within 1 ULP of std::log).
+KernelJob* submitLog(KernelEngine* engine, const double* input, double* output, long count);
+
+// Sign and log|det| of an n×n matrix (blocked LU with partial pivoting).
+KernelJob* submitDeterminant(KernelEngine* engine, const double* matrix, int n);
+
+// Sum, Frobenius norm, trace, minimum and maximum of an n×n matrix; the
+// result does not depend on the number of workers.
+KernelJob* submitReduce(KernelEngine* engine, const double* matrix, int n);
+
+// Cancels a queued job; false if it is already running or finished.
+bool jobCancel(KernelJob* job);
+
+KernelJobStatus jobStatus(KernelJob* job);
+
+// Waits until the job is done, cancelled or failed.
+KernelJobStatus jobWait(KernelJob* job);
+
+// Wait, then return the result of a determinant / reduce job. A cancelled or
+// failed job, or a job of another type, has no result: sign 0 and NaN
+// log|det| / every field NaN.
+LogDeterminant jobDeterminant(KernelJob* job);
+MatrixReduction<double> jobReduction(KernelJob* job);
+
+// Cancels the job if still queued, waits for it, and frees it (NULL is
+// ignored).
+void jobRelease(KernelJob* job);
+
+#endif
@@ -0,0 +1,4895 @@
+/********************************************************************
+ * Kernels shared by the library (matrixKernels.cpp) and the command-line
+ * driver (main.cpp): constants, views, SIMD helpers, the worker pool, work
+ * distribution, buffer allocation and the threaded kernels.
+ *
+ *              Everything here is in an anonymous namespace: each
+ *              translation unit that includes it gets its own copy with
+ *              internal linkage, so matrixKernels.o exports only the
+ *              interface of matrixKernels.h and a client is free to use
+ *              any of these names.
+ ********************************************************************/
+
+#ifndef MATRIX_KERNELS_INTERNAL_H
+#define MATRIX_KERNELS_INTERNAL_H
+
+#include <pthread.h>
+#include <sched.h>      // For CPU affinity functions
+#include <sys/mman.h>   // For mmap/madvise (matrix buffers, matrix files)
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>  // For the hardware performance counters
+#include <unistd.h>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <cfloat>
+#include <climits>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <ctime>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <limits>
+#include <new>
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+#include "matrixKernels.h"  // Library interface (LogDeterminant, MatrixReduction, the kernel engine)
+
+using namespace std;
+
+namespace 
+{
+
+const int DET_SIZE = 6;        // For determinant task (6×6 submatrix)
+const int LU_BLOCK = 64;       // Panel width of the blocked LU factorization
+
+// The transpose, log and multiplication kernels are templates over the
+// element type, with float, double and int32_t instantiated (int32_t:
+// transposes only). The determinants stay in double.
+
+// Transposition is done in TRANSPOSE_TILE×TRANSPOSE_TILE tiles: a source and a
+// destination tile of doubles (2 × 8 KiB) stay resident in a 32 KiB L1.
+const int TRANSPOSE_TILE = 32;
+
+// Edge of the block transposed in registers. Doubles: 8×8 in zmm registers
+// with AVX-512, 4×4 in ymm registers with AVX2 (and for the scalar fallback).
+// 32-bit elements: 8×8 in ymm registers with AVX2 or AVX-512, else 4×4.
+template <typename T> struct TransposeKernel { static const int EDGE = 4; };
+
+#if defined(__AVX512F__)
+template <> struct TransposeKernel<double> { static const int EDGE = 8; };
+#endif
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+template <> struct TransposeKernel<float> { static const int EDGE = 8; };
+template <> struct TransposeKernel<int32_t> { static const int EDGE = 8; };
+#endif
+
+// Accuracy tiers of the vectorized logarithm kernel.
+//   LOG_EXACT: fdlibm-style reduction and minimax polynomial, within 1 ULP of std::log.
+//   LOG_FAST:  truncated atanh series, |error| <= Tolerance<T>::LOG_FAST_MAX_ERROR * max(|log x|, 1).
+enum LogAccuracy { LOG_EXACT, LOG_FAST };
+
+// Element-wise transform fused into the transpose (OP_IDENTITY: plain transpose).
+enum ElementwiseOp { OP_IDENTITY, OP_LOG_EXACT, OP_LOG_FAST };
+
+// Distributions of the random matrix initialization (see the Random Matrix
+// Initialization section).
+//   FILL_POSITIVE: integers in [1, 1000] (the default workload: its logarithms are finite).
+//   FILL_UNIFORM:  uniform in [0, 1).
+//   FILL_NORMAL:   standard normal.
+enum RandomFill { FILL_POSITIVE, FILL_UNIFORM, FILL_NORMAL };
+
+template <typename T> struct SimdVec;
+
+// Blocking of the matrix multiplication C = αAB + βC (see the Matrix
+// Multiplication section). The micro-kernel keeps an MR×NR tile of C in
+// 2·MR vector registers, NR being two vectors wide. A KC×NR micro-panel of
+// packed B stays in L1, an MC×KC block of packed A in L2, and the KC×NC
+// panel of packed B in L3. One work unit is one MC×NC block of C.
+template <typename T> 
+struct GemmBlocking 
+{
+    static const int MR = 6;
+    static const int NR = 2 * SimdVec<T>::WIDTH;
+    static const int KC = 256;
+    static const int MC = 96;
+    static const int NC = 512;
+};
+
+// Reductions (see the Reductions section): rows per work unit of the column
+// reductions, and independent vector accumulators in the row loop.
+const int REDUCE_BLOCK_ROWS = 64;
+const int REDUCE_UNROLL = 4;
+
+// Where the pool workers are pinned, among the CPUs the process may use
+// (its affinity mask, which reflects the cgroup cpuset):
+//   PIN_NONE:    not pinned, the scheduler places (and migrates) them
+//   PIN_COMPACT: consecutive hardware threads, SMT siblings and cores of
+//                one socket first (workers share caches)
+//   PIN_SCATTER: round-robin over the sockets, one hardware thread per core
+//                before any SMT sibling (workers get the most cache and
+//                memory bandwidth)
+//   PIN_CORES:   one worker per physical core, socket by socket, never two
+//                on SMT siblings (cores are reused only when there are more
+//                workers than cores)
+enum PinPolicy { PIN_NONE, PIN_COMPACT, PIN_SCATTER, PIN_CORES };
+
+// How a kernel's work units (tiles, tile pairs, cache lines, ...) are dealt
+// to the workers; see the Work Distribution section.
+enum DistributionPolicy { DIST_BLOCK, DIST_CYCLIC, DIST_BLOCK_CYCLIC, DIST_DYNAMIC };
+
+const long DEFAULT_DIST_CHUNK = 16;  // Units per range for block-cyclic and dynamic
+const int TUNE_REPETITIONS = 3;      // Timed runs per candidate when tuning (best is kept)
+
+// Most stages the hardware counter report (--counters) keeps.
+const int MAX_PROFILE_STAGES = 32;
+
+// A policy with its parameters. Shared by all tasks of a job (by pointer):
+// the dynamic policy hands out ranges from the next counter.
+struct Distribution 
+{
+    DistributionPolicy policy;
+    long chunk;              // Units per range (block-cyclic, dynamic)
+    atomic<long> next;       // First unclaimed unit (dynamic)
+};
+
+// Non-owning view of a rows×cols row-major matrix whose rows are ld elements
+// apart (ld >= cols): a whole matrix, or a submatrix / rectangular region of
+// a larger one, used in place without copying. Kernels read through
+// MatrixView<const T> and write through MatrixView<T>.
+template <typename T>
+struct MatrixView 
+{
+    T* data;
+    int rows, cols;
+    long ld;               // Leading dimension: elements from one row to the next
+
+    T& operator()(long i, long j) const { return data[i * ld + j]; }
+
+    // A view of writable elements is also a read-only view.
+    operator MatrixView<const T>() const 
+    {
+        MatrixView<const T> view = { data, rows, cols, ld };
+
+        return view;
+    }
+};
+
+// The read-only view type of T. Taking inputs as ReadView<T>::Type keeps T
+// deduced from the output alone, so a MatrixView<T> converts implicitly.
+template <typename T>
+struct ReadView { typedef MatrixView<const T> Type; };
+
+template <typename T>
+MatrixView<T> matrixView(T* data, int rows, int cols, long ld)
+{
+    MatrixView<T> view = { data, rows, cols, ld };
+
+    return view;
+}
+
+// A whole n×n matrix.
+template <typename T>
+MatrixView<T> squareView(T* data, int n)
+{
+    return matrixView(data, n, n, n);
+}
+
+// The rows×cols region of view whose top-left element is (row, col).
+template <typename T>
+MatrixView<T> subView(const MatrixView<T>& view, int row, int col, int rows, int cols)
+{
+    return matrixView(&view(row, col), rows, cols, view.ld);
+}
+
+// Structures for passing parameters to thread functions
+
+// For the determinant task
+struct DetThreadData 
+{
+    int thread_id, numThreads;
+    MatrixView<const double> matrix; // The 6×6 (sub)matrix
+    Distribution* dist;   // Deals the columns of row 0 to the threads
+    double result;        // Output: sum of this thread's terms of the expansion
+};
+
+// For the LU factorization task
+struct LUThreadData 
+{
+    int thread_id, numThreads, n;
+    double* lu;                  // n×n matrix, factorized in place
+    int* pivots;                 // pivots[k]: row exchanged with row k at step k
+    pthread_barrier_t* barrier;  // Separates the panel, row-block and update phases
+};
+
+// For the triangular solves on an LU factorization
+struct LUSolveThreadData 
+{
+    int thread_id, numThreads, n, nrhs;
+    const double* lu;            // Factorization (see luFactorizeThread)
+    const int* pivots;
+    double* b;                   // n×nrhs right-hand sides, overwritten by the solutions
+    Distribution* dist;          // Deals the right-hand sides to the threads (in cache lines)
+};
+
+// For the batched small-matrix determinant task. The batch is stored
+// structure-of-arrays: element (i, j) of tile b is tiles[(i*size + j)*count + b],
+// so one SIMD load fetches the same element of consecutive tiles.
+struct BatchDetThreadData 
+{
+    int thread_id, numThreads;
+    int size;              // Tile edge (2..8)
+    long count;            // Number of tiles in the batch
+    const double* matrix;  // If not NULL: n×n source the tiles are cut from
+    int n;                 // Dimension of matrix
+    double* tiles;         // SoA batch (filled from matrix when given)
+    double* dets;          // Output: one determinant per tile
+    Distribution* dist;    // Deals groups of 8 tiles to the threads
+};
+
+// For transposition task
+template <typename T>
+struct TransposeThreadData 
+{
+    int thread_id, numThreads;
+    MatrixView<const T> input;  // rows×cols input (sub)matrix
+    MatrixView<T> output;       // cols×rows output (transposed)
+    ElementwiseOp op;     // Transform applied to every element on the way
+    int firstTileCol;     // Band of input tile columns to transpose
+    int numTileCols;      // (the whole matrix: 0 and the tiles per row)
+    Distribution* dist;   // Deals the tiles to the threads
+};
+
+// For in-place transposition task (square matrices only)
+template <typename T>
+struct InPlaceTransposeThreadData 
+{
+    int thread_id, numThreads;
+    MatrixView<T> matrix; // Square (sub)matrix, overwritten by its transpose
+    Distribution* dist;   // Deals the tile pairs to the threads
+};
+
+// For logarithm transformation task
+template <typename T>
+struct LogThreadData 
+{
+    int thread_id, numThreads;
+    long count;           // Number of elements
+    const T* input;       // Pointer to input matrix
+    T* output;            // Pointer to output (log-transformed) matrix
+    int rows;             // Strided views: rows of count elements, rows apart
+    long inputLd, outputLd;  // by the leading dimensions (rows 0: contiguous)
+    LogAccuracy accuracy; // Which polynomial tier to evaluate
+    Distribution* dist;   // Deals the cache lines (contiguous) or rows (views) to the threads
+};
+
+// For random matrix initialization
+template <typename T>
+struct RandomThreadData 
+{
+    int thread_id, numThreads;
+    long first, count;    // Elements [first, first + count) of the random sequence
+    T* output;            // Pointer to output matrix (element first)
+    RandomFill fill;
+    uint64_t key;         // Scrambled seed
+    Distribution* dist;   // Deals the cache lines to the threads
+};
+
+// For lazy element-wise expression task (see the Element-wise Expressions section)
+template <typename T, typename E>
+struct ExprThreadData 
+{
+    int thread_id, numThreads;
+    long count;           // Number of elements
+    const E* expr;        // Expression tree, evaluated at every index
+    T* output;            // Pointer to output matrix
+    Distribution* dist;   // Deals the cache lines to the threads
+};
+
+// One thread's running minimum and maximum, padded to a whole cache line:
+// the partials are updated throughout a job, and the partials of two threads
+// must not share a line.
+template <typename T>
+struct ReducePartial 
+{
+    T min, max;
+    char padding[64 - 2 * sizeof(T)];
+};
+
+// For reduction tasks. The output arrays are per row (row reductions) or per
+// block of REDUCE_BLOCK_ROWS rows and column (column reductions); NULL
+// arrays are not computed.
+template <typename T>
+struct ReduceThreadData 
+{
+    int thread_id, numThreads;
+    MatrixView<const T> matrix;  // The (sub)matrix reduced
+    int blocks;           // Row blocks (column reductions)
+    double* sums;         // Compensated sums
+    double* squares;      // Compensated sums of squares
+    T* mins;
+    T* maxs;
+    double* diagonal;     // Diagonal elements (row reductions)
+    ReducePartial<T>* partial; // This thread's running min/max (row reductions)
+    Distribution* dist;   // Deals the rows, row blocks or columns to the threads
+};
+
+// Per-row or per-column reduction results (one entry per row / column); NULL
+// arrays are not computed.
+template <typename T>
+struct LineReductions 
+{
+    double* sums;
+    double* squares;
+    T* mins;
+    T* maxs;
+};
+
+// Compressed sparse matrix. CSR stores the rows one after another (outer
+// lines = rows, indices = column numbers), CSC the columns (outer lines =
+// columns, indices = row numbers); indices ascend within every line. The CSC
+// arrays of A are the CSR arrays of Aᵀ.
+enum SparseLayout { SPARSE_CSR, SPARSE_CSC };
+
+template <typename T>
+struct SparseMatrix 
+{
+    SparseLayout layout;
+    int rows, cols;
+    long nnz;             // Stored entries
+    long* offsets;        // Outer line i holds entries offsets[i] .. offsets[i + 1] - 1
+    int* indices;         // Inner index of each entry
+    T* values;
+};
+
+// For sparse conversion and transpose tasks
+template <typename T>
+struct SparseThreadData 
+{
+    int thread_id, numThreads;
+    const SparseMatrix<T>* in;
+    SparseMatrix<T>* out;
+    T* dense;             // Row-major dense side of a conversion
+    long* counts;         // Transpose: per-thread entry counts (numThreads × inner lines)
+    long firstLine, lastLine;   // Transpose: this thread's block of outer lines
+    Distribution* dist;   // Deals the lines to the threads
+};
+
+// For matrix multiplication task: C = αAB + βC with A m×k, B k×n and C m×n,
+// all row-major with leading dimensions lda, ldb and ldc
+template <typename T>
+struct GemmThreadData 
+{
+    int thread_id, numThreads;
+    int m, n, k;          // Dimensions of the product
+    T alpha, beta;
+    const T* a;           // Pointer to A
+    long lda;
+    const T* b;           // Pointer to B
+    long ldb;
+    T* c;                 // Pointer to C, overwritten by the result
+    long ldc;
+    Distribution* dist;   // Deals the MC×NC blocks of C to the threads
+};
+
+// -----------------------------
+// SIMD Vector Helpers
+// -----------------------------
+// SimdVec<T> wraps one machine vector of T (8 doubles or 16 floats with
+// AVX-512, 4 doubles or 8 floats with AVX2, a single element otherwise). The simd* functions are also overloaded
+// for plain scalars, so a kernel written as a template over the value type
+// can be instantiated for the vector body and for the scalar tail alike.
+template <typename T> struct SimdVec;
+
+#if defined(__AVX512F__)
+template <> struct SimdVec<double> 
+{
+    static const int WIDTH = 8;
+    __m512d v;
+
+    SimdVec() {}
+    SimdVec(__m512d x) : v(x) {}
+    SimdVec(double x) : v(_mm512_set1_pd(x)) {}
+};
+
+typedef __mmask8 SimdMaskD;
+
+// All lanes. The unmasked forms of several AVX-512 intrinsics pass an
+// undefined source vector that GCC 12 reports as maybe-uninitialized; the
+// zero-masked forms with a full mask compile to the same instructions.
+const SimdMaskD SIMD_ALL_D = 0xFF;
+
+inline SimdVec<double> simdLoad(const double* p) { return _mm512_loadu_pd(p); }
+inline void simdStore(double* p, SimdVec<double> a) { _mm512_storeu_pd(p, a.v); }
+
+inline SimdVec<double> operator+(SimdVec<double> a, SimdVec<double> b) { return _mm512_add_pd(a.v, b.v); }
+inline SimdVec<double> operator-(SimdVec<double> a, SimdVec<double> b) { return _mm512_sub_pd(a.v, b.v); }
+inline SimdVec<double> operator*(SimdVec<double> a, SimdVec<double> b) { return _mm512_mul_pd(a.v, b.v); }
+inline SimdVec<double> operator/(SimdVec<double> a, SimdVec<double> b) { return _mm512_div_pd(a.v, b.v); }
+
+inline SimdVec<double> simdFma(SimdVec<double> a, SimdVec<double> b, SimdVec<double> c) { return _mm512_fmadd_pd(a.v, b.v, c.v); }
+
+inline SimdVec<double> simdAbs(SimdVec<double> a) { return _mm512_abs_pd(a.v); }
+inline SimdVec<double> simdSqrt(SimdVec<double> a) { return _mm512_maskz_sqrt_pd(SIMD_ALL_D, a.v); }
+inline SimdVec<double> simdMin(SimdVec<double> a, SimdVec<double> b) { return _mm512_maskz_min_pd(SIMD_ALL_D, a.v, b.v); }
+inline SimdVec<double> simdMax(SimdVec<double> a, SimdVec<double> b) { return _mm512_maskz_max_pd(SIMD_ALL_D, a.v, b.v); }
+
+inline SimdMaskD simdGreater(SimdVec<double> a, SimdVec<double> b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_GT_OQ); }
+inline SimdMaskD simdEqual(SimdVec<double> a, SimdVec<double> b) { return _mm512_cmp_pd_mask(a.v, b.v, _CMP_EQ_OQ); }
+
+// Lanes that are NaN or fall outside [lo, hi].
+inline SimdMaskD simdOutside(SimdVec<double> a, double lo, double hi) 
+{
+    return _mm512_cmp_pd_mask(a.v, _mm512_set1_pd(lo), _CMP_NGE_UQ) |
+           _mm512_cmp_pd_mask(a.v, _mm512_set1_pd(hi), _CMP_NLE_UQ);
+}
+
+inline bool simdAny(SimdMaskD m) { return m != 0; }
+
+// Lane-wise (m ? a : b).
+inline SimdVec<double> simdSelect(SimdMaskD m, SimdVec<double> a, SimdVec<double> b) { return _mm512_mask_blend_pd(m, b.v, a.v); }
+
+// Splits positive normal lanes into x = mantissa * 2^exponent, mantissa in [1, 2).
+inline SimdVec<double> simdSplitExponent(SimdVec<double> x, SimdVec<double>* mantissa) 
+{
+    mantissa->v = _mm512_maskz_getmant_pd(SIMD_ALL_D, x.v, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src);
+
+    return _mm512_maskz_getexp_pd(SIMD_ALL_D, x.v);
+}
+
+template <> struct SimdVec<float> 
+{
+    static const int WIDTH = 16;
+    __m512 v;
+
+    SimdVec() {}
+    SimdVec(__m512 x) : v(x) {}
+    SimdVec(float x) : v(_mm512_set1_ps(x)) {}
+};
+
+typedef __mmask16 SimdMaskF;
+
+const SimdMaskF SIMD_ALL_F = 0xFFFF;  // All lanes (see SIMD_ALL_D)
+
+inline SimdVec<float> simdLoad(const float* p) { return _mm512_loadu_ps(p); }
+inline void simdStore(float* p, SimdVec<float> a) { _mm512_storeu_ps(p, a.v); }
+
+inline SimdVec<float> operator+(SimdVec<float> a, SimdVec<float> b) { return _mm512_add_ps(a.v, b.v); }
+inline SimdVec<float> operator-(SimdVec<float> a, SimdVec<float> b) { return _mm512_sub_ps(a.v, b.v); }
+inline SimdVec<float> operator*(SimdVec<float> a, SimdVec<float> b) { return _mm512_mul_ps(a.v, b.v); }
+inline SimdVec<float> operator/(SimdVec<float> a, SimdVec<float> b) { return _mm512_div_ps(a.v, b.v); }
+
+inline SimdVec<float> simdFma(SimdVec<float> a, SimdVec<float> b, SimdVec<float> c) { return _mm512_fmadd_ps(a.v, b.v, c.v); }
+
+inline SimdVec<float> simdAbs(SimdVec<float> a) { return _mm512_abs_ps(a.v); }
+inline SimdVec<float> simdSqrt(SimdVec<float> a) { return _mm512_maskz_sqrt_ps(SIMD_ALL_F, a.v); }
+inline SimdVec<float> simdMin(SimdVec<float> a, SimdVec<float> b) { return _mm512_maskz_min_ps(SIMD_ALL_F, a.v, b.v); }
+inline SimdVec<float> simdMax(SimdVec<float> a, SimdVec<float> b) { return _mm512_maskz_max_ps(SIMD_ALL_F, a.v, b.v); }
+
+inline SimdMaskF simdGreater(SimdVec<float> a, SimdVec<float> b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ); }
+inline SimdMaskF simdEqual(SimdVec<float> a, SimdVec<float> b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_EQ_OQ); }
+
+inline SimdMaskF simdOutside(SimdVec<float> a, float lo, float hi) 
+{
+    return _mm512_cmp_ps_mask(a.v, _mm512_set1_ps(lo), _CMP_NGE_UQ) |
+           _mm512_cmp_ps_mask(a.v, _mm512_set1_ps(hi), _CMP_NLE_UQ);
+}
+
+inline bool simdAny(SimdMaskF m) { return m != 0; }
+
+inline SimdVec<float> simdSelect(SimdMaskF m, SimdVec<float> a, SimdVec<float> b) { return _mm512_mask_blend_ps(m, b.v, a.v); }
+
+inline SimdVec<float> simdSplitExponent(SimdVec<float> x, SimdVec<float>* mantissa) 
+{
+    mantissa->v = _mm512_maskz_getmant_ps(SIMD_ALL_F, x.v, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_src);
+
+    return _mm512_maskz_getexp_ps(SIMD_ALL_F, x.v);
+}
+#elif defined(__AVX2__)
+template <> struct SimdVec<double> 
+{
+    static const int WIDTH = 4;
+    __m256d v;
+
+    SimdVec() {}
+    SimdVec(__m256d x) : v(x) {}
+    SimdVec(double x) : v(_mm256_set1_pd(x)) {}
+};
+
+typedef __m256d SimdMaskD;
+
+inline SimdVec<double> simdLoad(const double* p) { return _mm256_loadu_pd(p); }
+inline void simdStore(double* p, SimdVec<double> a) { _mm256_storeu_pd(p, a.v); }
+
+inline SimdVec<double> operator+(SimdVec<double> a, SimdVec<double> b) { return _mm256_add_pd(a.v, b.v); }
+inline SimdVec<double> operator-(SimdVec<double> a, SimdVec<double> b) { return _mm256_sub_pd(a.v, b.v); }
+inline SimdVec<double> operator*(SimdVec<double> a, SimdVec<double> b) { return _mm256_mul_pd(a.v, b.v); }
+inline SimdVec<double> operator/(SimdVec<double> a, SimdVec<double> b) { return _mm256_div_pd(a.v, b.v); }
+
+// a * b + c, fused when the FMA extension is enabled.
+#if defined(__FMA__)
+inline SimdVec<double> simdFma(SimdVec<double> a, SimdVec<double> b, SimdVec<double> c) { return _mm256_fmadd_pd(a.v, b.v, c.v); }
+#else
+inline SimdVec<double> simdFma(SimdVec<double> a, SimdVec<double> b, SimdVec<double> c) { return _mm256_add_pd(_mm256_mul_pd(a.v, b.v), c.v); }
+#endif
+
+inline SimdVec<double> simdAbs(SimdVec<double> a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v); }
+inline SimdVec<double> simdSqrt(SimdVec<double> a) { return _mm256_sqrt_pd(a.v); }
+
+// min and max return b when either lane is NaN, like (a < b ? a : b).
+inline SimdVec<double> simdMin(SimdVec<double> a, SimdVec<double> b) { return _mm256_min_pd(a.v, b.v); }
+inline SimdVec<double> simdMax(SimdVec<double> a, SimdVec<double> b) { return _mm256_max_pd(a.v, b.v); }
+
+inline SimdMaskD simdGreater(SimdVec<double> a, SimdVec<double> b) { return _mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ); }
+inline SimdMaskD simdEqual(SimdVec<double> a, SimdVec<double> b) { return _mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ); }
+
+// Lanes that are NaN or fall outside [lo, hi].
+inline SimdMaskD simdOutside(SimdVec<double> a, double lo, double hi) 
+{
+    return _mm256_or_pd(_mm256_cmp_pd(a.v, _mm256_set1_pd(lo), _CMP_NGE_UQ),
+                        _mm256_cmp_pd(a.v, _mm256_set1_pd(hi), _CMP_NLE_UQ));
+}
+
+inline bool simdAny(SimdMaskD m) { return _mm256_movemask_pd(m) != 0; }
+
+// Lane-wise (m ? a : b).
+inline SimdVec<double> simdSelect(SimdMaskD m, SimdVec<double> a, SimdVec<double> b) { return _mm256_blendv_pd(b.v, a.v, m); }
+
+// Splits positive normal lanes into x = mantissa * 2^exponent, mantissa in [1, 2).
+// The biased exponent is turned into a double by planting it in the mantissa
+// of 2^52 (AVX2 has no 64-bit integer to double conversion).
+inline SimdVec<double> simdSplitExponent(SimdVec<double> x, SimdVec<double>* mantissa) 
+{
+    __m256i bits = _mm256_castpd_si256(x.v);
+
+    __m256i mantissaBits = _mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL));
+
+    mantissa->v = _mm256_castsi256_pd(_mm256_or_si256(mantissaBits, _mm256_set1_epi64x(0x3FF0000000000000LL)));
+
+    __m256i biased = _mm256_or_si256(_mm256_srli_epi64(bits, 52), _mm256_set1_epi64x(0x4330000000000000LL));
+
+    return _mm256_sub_pd(_mm256_castsi256_pd(biased), _mm256_set1_pd(4503599627370496.0 + 1023.0));
+}
+
+template <> struct SimdVec<float> 
+{
+    static const int WIDTH = 8;
+    __m256 v;
+
+    SimdVec() {}
+    SimdVec(__m256 x) : v(x) {}
+    SimdVec(float x) : v(_mm256_set1_ps(x)) {}
+};
+
+typedef __m256 SimdMaskF;
+
+inline SimdVec<float> simdLoad(const float* p) { return _mm256_loadu_ps(p); }
+inline void simdStore(float* p, SimdVec<float> a) { _mm256_storeu_ps(p, a.v); }
+
+inline SimdVec<float> operator+(SimdVec<float> a, SimdVec<float> b) { return _mm256_add_ps(a.v, b.v); }
+inline SimdVec<float> operator-(SimdVec<float> a, SimdVec<float> b) { return _mm256_sub_ps(a.v, b.v); }
+inline SimdVec<float> operator*(SimdVec<float> a, SimdVec<float> b) { return _mm256_mul_ps(a.v, b.v); }
+inline SimdVec<float> operator/(SimdVec<float> a, SimdVec<float> b) { return _mm256_div_ps(a.v, b.v); }
+
+#if defined(__FMA__)
+inline SimdVec<float> simdFma(SimdVec<float> a, SimdVec<float> b, SimdVec<float> c) { return _mm256_fmadd_ps(a.v, b.v, c.v); }
+#else
+inline SimdVec<float> simdFma(SimdVec<float> a, SimdVec<float> b, SimdVec<float> c) { return _mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v); }
+#endif
+
+inline SimdVec<float> simdAbs(SimdVec<float> a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+inline SimdVec<float> simdSqrt(SimdVec<float> a) { return _mm256_sqrt_ps(a.v); }
+inline SimdVec<float> simdMin(SimdVec<float> a, SimdVec<float> b) { return _mm256_min_ps(a.v, b.v); }
+inline SimdVec<float> simdMax(SimdVec<float> a, SimdVec<float> b) { return _mm256_max_ps(a.v, b.v); }
+
+inline SimdMaskF simdGreater(SimdVec<float> a, SimdVec<float> b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+inline SimdMaskF simdEqual(SimdVec<float> a, SimdVec<float> b) { return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ); }
+
+inline SimdMaskF simdOutside(SimdVec<float> a, float lo, float hi) 
+{
+    return _mm256_or_ps(_mm256_cmp_ps(a.v, _mm256_set1_ps(lo), _CMP_NGE_UQ),
+                        _mm256_cmp_ps(a.v, _mm256_set1_ps(hi), _CMP_NLE_UQ));
+}
+
+inline bool simdAny(SimdMaskF m) { return _mm256_movemask_ps(m) != 0; }
+
+inline SimdVec<float> simdSelect(SimdMaskF m, SimdVec<float> a, SimdVec<float> b) { return _mm256_blendv_ps(b.v, a.v, m); }
+
+// 32-bit lanes convert directly: exponent = (bits >> 23) - 127 for positive x.
+inline SimdVec<float> simdSplitExponent(SimdVec<float> x, SimdVec<float>* mantissa) 
+{
+    __m256i bits = _mm256_castps_si256(x.v);
+
+    __m256i mantissaBits = _mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF));
+
+    mantissa->v = _mm256_castsi256_ps(_mm256_or_si256(mantissaBits, _mm256_set1_epi32(0x3F800000)));
+
+    return _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127)));
+}
+#else
+template <> struct SimdVec<double> 
+{
+    static const int WIDTH = 1;
+    double v;
+
+    SimdVec() {}
+    SimdVec(double x) : v(x) {}
+};
+
+typedef bool SimdMaskD;
+
+inline SimdVec<double> simdLoad(const double* p) { return *p; }
+inline void simdStore(double* p, SimdVec<double> a) { *p = a.v; }
+
+inline SimdVec<double> operator+(SimdVec<double> a, SimdVec<double> b) { return a.v + b.v; }
+inline SimdVec<double> operator-(SimdVec<double> a, SimdVec<double> b) { return a.v - b.v; }
+inline SimdVec<double> operator*(SimdVec<double> a, SimdVec<double> b) { return a.v * b.v; }
+inline SimdVec<double> operator/(SimdVec<double> a, SimdVec<double> b) { return a.v / b.v; }
+
+inline SimdVec<double> simdFma(SimdVec<double> a, SimdVec<double> b, SimdVec<double> c) { return a.v * b.v + c.v; }
+
+inline SimdVec<double> simdAbs(SimdVec<double> a) { return fabs(a.v); }
+inline SimdVec<double> simdSqrt(SimdVec<double> a) { return sqrt(a.v); }
+inline SimdVec<double> simdMin(SimdVec<double> a, SimdVec<double> b) { return a.v < b.v ? a.v : b.v; }
+inline SimdVec<double> simdMax(SimdVec<double> a, SimdVec<double> b) { return a.v > b.v ? a.v : b.v; }
+
+inline SimdMaskD simdGreater(SimdVec<double> a, SimdVec<double> b) { return a.v > b.v; }
+inline SimdMaskD simdEqual(SimdVec<double> a, SimdVec<double> b) { return a.v == b.v; }
+inline SimdMaskD simdOutside(SimdVec<double> a, double lo, double hi) { return !(a.v >= lo && a.v <= hi); }
+inline bool simdAny(SimdMaskD m) { return m; }
+inline SimdVec<double> simdSelect(SimdMaskD m, SimdVec<double> a, SimdVec<double> b) { return m ? a : b; }
+
+inline SimdVec<double> simdSplitExponent(SimdVec<double> x, SimdVec<double>* mantissa);
+
+template <> struct SimdVec<float> 
+{
+    static const int WIDTH = 1;
+    float v;
+
+    SimdVec() {}
+    SimdVec(float x) : v(x) {}
+};
+
+typedef bool SimdMaskF;
+
+inline SimdVec<float> simdLoad(const float* p) { return *p; }
+inline void simdStore(float* p, SimdVec<float> a) { *p = a.v; }
+
+inline SimdVec<float> operator+(SimdVec<float> a, SimdVec<float> b) { return a.v + b.v; }
+inline SimdVec<float> operator-(SimdVec<float> a, SimdVec<float> b) { return a.v - b.v; }
+inline SimdVec<float> operator*(SimdVec<float> a, SimdVec<float> b) { return a.v * b.v; }
+inline SimdVec<float> operator/(SimdVec<float> a, SimdVec<float> b) { return a.v / b.v; }
+
+inline SimdVec<float> simdFma(SimdVec<float> a, SimdVec<float> b, SimdVec<float> c) { return a.v * b.v + c.v; }
+
+inline SimdVec<float> simdAbs(SimdVec<float> a) { return fabsf(a.v); }
+inline SimdVec<float> simdSqrt(SimdVec<float> a) { return sqrtf(a.v); }
+inline SimdVec<float> simdMin(SimdVec<float> a, SimdVec<float> b) { return a.v < b.v ? a.v : b.v; }
+inline SimdVec<float> simdMax(SimdVec<float> a, SimdVec<float> b) { return a.v > b.v ? a.v : b.v; }
+
+inline SimdMaskF simdGreater(SimdVec<float> a, SimdVec<float> b) { return a.v > b.v; }
+inline SimdMaskF simdEqual(SimdVec<float> a, SimdVec<float> b) { return a.v == b.v; }
+inline SimdMaskF simdOutside(SimdVec<float> a, float lo, float hi) { return !(a.v >= lo && a.v <= hi); }
+inline SimdVec<float> simdSelect(SimdMaskF m, SimdVec<float> a, SimdVec<float> b) { return m ? a : b; }
+
+inline SimdVec<float> simdSplitExponent(SimdVec<float> x, SimdVec<float>* mantissa);
+#endif
+
+// Scalar overloads, used for loop tails and special-value lanes.
+inline double simdAbs(double a) { return fabs(a); }
+inline double simdSqrt(double a) { return sqrt(a); }
+inline double simdMin(double a, double b) { return a < b ? a : b; }
+inline double simdMax(double a, double b) { return a > b ? a : b; }
+inline bool simdGreater(double a, double b) { return a > b; }
+inline bool simdEqual(double a, double b) { return a == b; }
+inline double simdSelect(bool m, double a, double b) { return m ? a : b; }
+
+inline float simdAbs(float a) { return fabsf(a); }
+inline float simdSqrt(float a) { return sqrtf(a); }
+inline float simdMin(float a, float b) { return a < b ? a : b; }
+inline float simdMax(float a, float b) { return a > b ? a : b; }
+inline bool simdGreater(float a, float b) { return a > b; }
+inline bool simdEqual(float a, float b) { return a == b; }
+inline float simdSelect(bool m, float a, float b) { return m ? a : b; }
+
+inline double simdSplitExponent(double x, double* mantissa) 
+{
+    uint64_t bits;
+
+    memcpy(&bits, &x, sizeof(bits));
+
+    uint64_t mantissaBits = (bits & 0x000FFFFFFFFFFFFFULL) | 0x3FF0000000000000ULL;
+
+    memcpy(mantissa, &mantissaBits, sizeof(mantissaBits));
+
+    return (double) ((int) (bits >> 52) - 1023);
+}
+
+inline float simdSplitExponent(float x, float* mantissa) 
+{
+    uint32_t bits;
+
+    memcpy(&bits, &x, sizeof(bits));
+
+    uint32_t mantissaBits = (bits & 0x007FFFFFU) | 0x3F800000U;
+
+    memcpy(mantissa, &mantissaBits, sizeof(mantissaBits));
+
+    return (float) ((int) (bits >> 23) - 127);
+}
+
+#if !defined(__AVX2__) && !defined(__AVX512F__)
+inline SimdVec<double> simdSplitExponent(SimdVec<double> x, SimdVec<double>* mantissa) 
+{
+    return simdSplitExponent(x.v, &mantissa->v);
+}
+
+inline SimdVec<float> simdSplitExponent(SimdVec<float> x, SimdVec<float>* mantissa) 
+{
+    return simdSplitExponent(x.v, &mantissa->v);
+}
+#endif
+
+// Element type of a scalar or of a SimdVec.
+template <typename V> struct ElementOf { typedef V type; };
+template <typename T> struct ElementOf<SimdVec<T> > { typedef T type; };
+
+// -----------------------------
+// Hardware Performance Counters
+// -----------------------------
+// Opt-in (--counters): every pool worker opens its own counting events with
+// perf_event_open (user space only, this thread only, on whichever CPU it
+// runs), and the pool adds up, per worker, what its job tasks consume.
+// Events the kernel or the (virtual) PMU refuses are left out individually.
+// When there are more events than hardware counters (the NMI watchdog holds
+// one), the kernel time-slices them: each is read with the time it was
+// enabled and the time it actually ran, and its count over a job is scaled
+// by enabled / running, so that all events estimate the same interval.
+enum CounterEvent { CTR_CYCLES, CTR_INSTRUCTIONS, CTR_L1D_MISSES, CTR_LLC_MISSES, CTR_DTLB_MISSES, NUM_COUNTERS };
+
+const char* const COUNTER_NAMES[NUM_COUNTERS] = { "cycles", "instructions", "L1d misses", "LLC misses", "dTLB misses" };
+
+// Counting events of one worker thread.
+struct ThreadCounters 
+{
+    int fds[NUM_COUNTERS];               // -1: event not available
+    int cyclesError;                     // errno when the cycles event failed to open
+    uint64_t accumulated[NUM_COUNTERS];  // Counts inside job tasks so far (scaled)
+    long multiplexed;                    // Jobs in which some event was time-sliced
+};
+
+// One read of an event (read_format TOTAL_TIME_ENABLED | TOTAL_TIME_RUNNING).
+struct CounterReading 
+{
+    uint64_t value;
+    uint64_t enabled;    // Nanoseconds the event was enabled
+    uint64_t running;    // Nanoseconds it was on a hardware counter
+};
+
+// Opens one event counting the calling thread in user space; -1 on failure.
+inline int openCounter(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Thread function that opens the counters of the calling worker.
+inline void* openCountersThread(void* arg) 
+{
+    ThreadCounters* counters = (ThreadCounters*) arg;
+
+    const uint64_t READ_MISS = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+    counters->fds[CTR_CYCLES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    counters->cyclesError = (counters->fds[CTR_CYCLES] < 0) ? errno : 0;
+    counters->fds[CTR_INSTRUCTIONS] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    counters->fds[CTR_L1D_MISSES] = openCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | READ_MISS);
+    counters->fds[CTR_LLC_MISSES] = openCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    counters->fds[CTR_DTLB_MISSES] = openCounter(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | READ_MISS);
+
+    for (int c = 0; c < NUM_COUNTERS; c++)
+        counters->accumulated[c] = 0;
+
+    counters->multiplexed = 0;
+
+    return NULL;
+}
+
+// Reads every available event (zeros for the others).
+inline void readCounters(const ThreadCounters* counters, CounterReading* readings)
+{
+    for (int c = 0; c < NUM_COUNTERS; c++) 
+    {
+        memset(&readings[c], 0, sizeof(readings[c]));
+
+        if (counters->fds[c] >= 0 && read(counters->fds[c], &readings[c], sizeof(readings[c])) != sizeof(readings[c]))
+            memset(&readings[c], 0, sizeof(readings[c]));
+    }
+}
+
+// Adds the counts between two readings, each scaled by the time its event
+// was enabled over the time it ran; notes the job if any was time-sliced.
+inline void accumulateCounters(ThreadCounters* counters, const CounterReading* before, const CounterReading* after)
+{
+    bool multiplexed = false;
+
+    for (int c = 0; c < NUM_COUNTERS; c++) 
+    {
+        uint64_t count = after[c].value - before[c].value;
+        uint64_t enabled = after[c].enabled - before[c].enabled;
+        uint64_t running = after[c].running - before[c].running;
+
+        if (running < enabled) 
+        {
+            multiplexed = true;
+
+            count = (running > 0) ? (uint64_t) ((double) count * enabled / running) : 0;
+        }
+
+        counters->accumulated[c] += count;
+    }
+
+    if (multiplexed)
+        counters->multiplexed++;
+}
+
+// -----------------------------
+// Persistent Worker Pool
+// -----------------------------
+// The pool owns its threads for the lifetime of the process. A job is a
+// parallel-for over count task descriptors laid out argSize bytes apart;
+// worker w runs tasks w, w + numThreads, ... so a job with exactly numThreads
+// tasks runs one task per worker, concurrently (which the LU barrier relies
+// on), and a task index always lands on the same (pinned) worker.
+// A CPU the process may run on, with its place in the machine topology.
+struct CpuInfo 
+{
+    int cpu;        // Logical CPU number
+    int package;    // Physical package (socket)
+    int core;       // Core id within the package
+    int node;       // NUMA node (0 when unknown)
+    int sibling;    // Index among the SMT siblings of its core (0: first)
+};
+
+struct WorkerPool 
+{
+    int numThreads;
+    pthread_t* threads;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t workReady;   // Signalled when a new job is published
+    pthread_cond_t workDone;    // Signalled when the last worker finishes a job
+
+    long generation;            // Incremented for every job
+    int pending;                // Workers that have not finished the current job
+    bool shutdown;
+
+    // Current job
+    void* (*task)(void*);
+    char* args;
+    size_t argSize;
+    int count;
+
+    ThreadCounters* counters;   // Per worker; NULL unless poolEnableCounters was called
+
+    PinPolicy pinning;
+    CpuInfo* placement;         // Per worker: the CPU it is pinned to (PIN_NONE: unused)
+};
+
+// Start-up parameters of one pool worker.
+struct WorkerStartData 
+{
+    WorkerPool* pool;
+    int worker_id;
+};
+
+// Binds the given thread to the specified core.
+inline void setAffinity(pthread_t thread, int coreId) 
+{
+    cpu_set_t cpuset;
+    
+    CPU_ZERO(&cpuset);             // Clearing the CPU set
+    CPU_SET(coreId, &cpuset);      // Setting the desired CPU core
+
+    // Applying the CPU affinity settings to the thread
+    int result = pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpuset);
+    
+    if (result != 0) 
+        cerr << "Error setting thread affinity to core " << coreId << endl;
+}
+
+// Reads a single integer from a sysfs file; fallback if it is missing.
+inline int readSysfsInt(const char* path, int fallback)
+{
+    ifstream file(path);
+
+    int value;
+
+    return (file >> value) ? value : fallback;
+}
+
+// Lists the CPUs of the process's affinity mask (so a cgroup cpuset or a
+// taskset is respected) with their package, core and NUMA node from
+// /sys/devices/system/cpu; returns the count. Numbers the SMT siblings of
+// each core in CPU order.
+inline int readCpuTopology(CpuInfo* cpus)
+{
+    cpu_set_t allowed;
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return 0;
+
+    int count = 0;
+    char path[128];
+
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) 
+    {
+        if (!CPU_ISSET(cpu, &allowed))
+            continue;
+
+        CpuInfo* info = &cpus[count++];
+
+        info->cpu = cpu;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+        info->package = readSysfsInt(path, 0);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+        info->core = readSysfsInt(path, cpu);
+
+        // The CPU's directory holds a nodeN link for its NUMA node.
+        info->node = 0;
+
+        for (int node = 0; node < 64; node++) 
+        {
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/node%d", cpu, node);
+
+            if (access(path, F_OK) == 0) 
+            {
+                info->node = node;
+
+                break;
+            }
+        }
+
+        info->sibling = 0;
+
+        for (int other = 0; other < count - 1; other++)
+            if (cpus[other].package == info->package && cpus[other].core == info->core)
+                info->sibling++;
+    }
+
+    return count;
+}
+
+// Orders the usable CPUs for a placement policy; worker w is then pinned to
+// order[w % count] (PIN_CORES: count is the number of physical cores).
+inline int planPlacement(PinPolicy policy, CpuInfo* cpus, int count, CpuInfo* order)
+{
+    // Compact: by package, core, then sibling.
+    sort(cpus, cpus + count, [](const CpuInfo& a, const CpuInfo& b) {
+        if (a.package != b.package) return a.package < b.package;
+        if (a.core != b.core) return a.core < b.core;
+        return a.sibling < b.sibling;
+    });
+
+    if (policy == PIN_COMPACT) 
+    {
+        copy(cpus, cpus + count, order);
+
+        return count;
+    }
+
+    // Cores: the first hardware thread of each core, in compact order.
+    if (policy == PIN_CORES) 
+    {
+        int used = 0;
+
+        for (int i = 0; i < count; i++)
+            if (cpus[i].sibling == 0)
+                order[used++] = cpus[i];
+
+        return used;
+    }
+
+    // Scatter: first hardware threads of all cores before any second
+    // sibling, the packages taking turns at each level.
+    CpuInfo* spread = new CpuInfo[count];
+
+    copy(cpus, cpus + count, spread);
+
+    int* rank = new int[count];   // Position of each CPU's core within its package
+
+    for (int i = 0; i < count; i++) 
+    {
+        rank[i] = 0;
+
+        for (int j = 0; j < i; j++)
+            if (cpus[j].package == cpus[i].package && cpus[j].sibling == cpus[i].sibling)
+                rank[i]++;
+
+        spread[i].cpu = i;        // Temporarily: index into cpus and rank
+    }
+
+    sort(spread, spread + count, [&](const CpuInfo& a, const CpuInfo& b) {
+        if (a.sibling != b.sibling) return a.sibling < b.sibling;
+        if (rank[a.cpu] != rank[b.cpu]) return rank[a.cpu] < rank[b.cpu];
+        return a.package < b.package;
+    });
+
+    for (int i = 0; i < count; i++)
+        order[i] = cpus[spread[i].cpu];
+
+    delete[] spread;
+    delete[] rank;
+
+    return count;
+}
+
+const char* pinPolicyName(PinPolicy policy)
+{
+    switch (policy) 
+    {
+        case PIN_NONE: return "none";
+        case PIN_COMPACT: return "compact";
+        case PIN_SCATTER: return "scatter";
+        default: return "cores";
+    }
+}
+
+inline bool parsePinPolicy(const char* name, PinPolicy* policy)
+{
+    if (strcmp(name, "none") == 0)
+        *policy = PIN_NONE;
+    else if (strcmp(name, "compact") == 0)
+        *policy = PIN_COMPACT;
+    else if (strcmp(name, "scatter") == 0)
+        *policy = PIN_SCATTER;
+    else if (strcmp(name, "cores") == 0)
+        *policy = PIN_CORES;
+    else
+        return false;
+
+    return true;
+}
+
+// Thread function of a pool worker: waits for a job, runs its share of the
+// tasks, reports completion, and repeats until the pool is shut down.
+inline void* poolWorkerThread(void* arg) 
+{
+    WorkerStartData* start = (WorkerStartData*) arg;
+
+    WorkerPool* pool = start->pool;
+    int worker_id = start->worker_id;
+
+    delete start;
+
+    long seenGeneration = 0;
+
+    while (true) 
+    {
+        pthread_mutex_lock(&pool->mutex);
+
+        while (!pool->shutdown && pool->generation == seenGeneration)
+            pthread_cond_wait(&pool->workReady, &pool->mutex);
+
+        if (pool->shutdown) 
+        {
+            pthread_mutex_unlock(&pool->mutex);
+
+            break;
+        }
+
+        seenGeneration = pool->generation;
+
+        void* (*task)(void*) = pool->task;
+        char* args = pool->args;
+        size_t argSize = pool->argSize;
+        int count = pool->count;
+        ThreadCounters* counters = pool->counters;
+
+        pthread_mutex_unlock(&pool->mutex);
+
+        CounterReading before[NUM_COUNTERS], after[NUM_COUNTERS];
+
+        if (counters != NULL)
+            readCounters(&counters[worker_id], before);
+
+        for (int i = worker_id; i < count; i += pool->numThreads)
+            task(args + i * argSize);
+
+        if (counters != NULL) 
+        {
+            readCounters(&counters[worker_id], after);
+
+            accumulateCounters(&counters[worker_id], before, after);
+        }
+
+        pthread_mutex_lock(&pool->mutex);
+
+        if (--pool->pending == 0)
+            pthread_cond_signal(&pool->workDone);
+
+        pthread_mutex_unlock(&pool->mutex);
+    }
+
+    return NULL;
+}
+
+// Number of CPUs the process may run on (the default thread count).
+inline int availableCpus()
+{
+    cpu_set_t allowed;
+
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return 1;
+
+    return CPU_COUNT(&allowed);
+}
+
+inline void poolDestroy(WorkerPool* pool);
+
+// Starts numThreads workers, pinned by the given policy. Since a task index
+// always runs on the same worker, the pages a worker first touches (see the
+// allocator) stay on its NUMA node and the tiles it later processes from
+// them are local. False (with the workers already started joined, and the
+// pool freed) if a worker thread cannot be created.
+inline bool poolTryCreate(WorkerPool* pool, int numThreads, PinPolicy pinning)
+{
+    pool->numThreads = numThreads;
+    pool->threads = new pthread_t[numThreads];
+    pool->generation = 0;
+    pool->pending = 0;
+    pool->shutdown = false;
+    pool->task = NULL;
+    pool->args = NULL;
+    pool->argSize = 0;
+    pool->count = 0;
+    pool->counters = NULL;
+    pool->pinning = pinning;
+    pool->placement = new CpuInfo[numThreads];
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->workReady, NULL);
+    pthread_cond_init(&pool->workDone, NULL);
+
+    CpuInfo* cpus = new CpuInfo[CPU_SETSIZE];
+    CpuInfo* order = new CpuInfo[CPU_SETSIZE];
+
+    int numAllowed = (pinning == PIN_NONE) ? 0 : readCpuTopology(cpus);
+    int numTargets = (numAllowed > 0) ? planPlacement(pinning, cpus, numAllowed, order) : 0;
+
+    if (numTargets == 0)
+        pool->pinning = PIN_NONE;
+
+    for (int w = 0; w < numThreads; w++) 
+    {
+        WorkerStartData* start = new WorkerStartData;
+
+        start->pool = pool;
+        start->worker_id = w;
+
+        if (pthread_create(&pool->threads[w], NULL, poolWorkerThread, (void*) start) != 0) 
+        {
+            delete start;
+
+            pool->numThreads = w;
+
+            poolDestroy(pool);
+
+            delete[] cpus;
+            delete[] order;
+
+            return false;
+        }
+
+        if (numTargets > 0) 
+        {
+            pool->placement[w] = order[w % numTargets];
+
+            setAffinity(pool->threads[w], pool->placement[w].cpu);
+        }
+    }
+
+    delete[] cpus;
+    delete[] order;
+
+    return true;
+}
+
+inline void poolCreate(WorkerPool* pool, int numThreads, PinPolicy pinning)
+{
+    if (!poolTryCreate(pool, numThreads, pinning)) 
+    {
+        cerr << "Error: unable to create the pool worker threads" << endl;
+
+        exit(-1);
+    }
+}
+
+// A pool without threads: poolRun runs the tasks on the calling thread, one
+// after the other. The kernel engine gives one to each worker, so that a
+// worker can run a whole small job through the ordinary launchers.
+inline void poolCreateInline(WorkerPool* pool)
+{
+    pool->numThreads = 1;
+    pool->threads = NULL;
+    pool->generation = 0;
+    pool->pending = 0;
+    pool->shutdown = false;
+    pool->task = NULL;
+    pool->args = NULL;
+    pool->argSize = 0;
+    pool->count = 0;
+    pool->counters = NULL;
+    pool->pinning = PIN_NONE;
+    pool->placement = NULL;
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->workReady, NULL);
+    pthread_cond_init(&pool->workDone, NULL);
+}
+
+// Prints the worker → CPU mapping chosen by the pool's placement policy.
+inline void printPlacement(const WorkerPool* pool)
+{
+    if (pool->pinning == PIN_NONE) 
+    {
+        cout << "> Workers not pinned" << endl;
+
+        return;
+    }
+
+    cout << "> Worker placement (" << pinPolicyName(pool->pinning) << "):" << endl;
+
+    for (int w = 0; w < pool->numThreads; w++) 
+    {
+        const CpuInfo* info = &pool->placement[w];
+
+        cout << "   worker " << w << " -> CPU " << info->cpu << " (package " << info->package 
+             << ", core " << info->core << (info->sibling > 0 ? ", SMT sibling" : "") 
+             << ", node " << info->node << ")" << endl;
+    }
+}
+
+// Runs task on each of the count descriptors at args (argSize bytes apart)
+// and returns once all of them have finished (the barrier between stages).
+inline void poolRun(WorkerPool* pool, void* (*task)(void*), void* args, size_t argSize, int count)
+{
+    if (pool->threads == NULL) 
+    {
+        for (int i = 0; i < count; i++)
+            task((char*) args + i * argSize);
+
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+
+    pool->task = task;
+    pool->args = (char*) args;
+    pool->argSize = argSize;
+    pool->count = count;
+    pool->pending = pool->numThreads;
+    pool->generation++;
+
+    pthread_cond_broadcast(&pool->workReady);
+
+    while (pool->pending > 0)
+        pthread_cond_wait(&pool->workDone, &pool->mutex);
+
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+// Stops and joins the workers.
+inline void poolDestroy(WorkerPool* pool)
+{
+    if (pool->threads == NULL) 
+    {
+        pthread_mutex_destroy(&pool->mutex);
+        pthread_cond_destroy(&pool->workReady);
+        pthread_cond_destroy(&pool->workDone);
+
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+
+    pool->shutdown = true;
+
+    pthread_cond_broadcast(&pool->workReady);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int w = 0; w < pool->numThreads; w++)
+        pthread_join(pool->threads[w], NULL);
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->workReady);
+    pthread_cond_destroy(&pool->workDone);
+
+    if (pool->counters != NULL) 
+    {
+        for (int w = 0; w < pool->numThreads; w++)
+            for (int c = 0; c < NUM_COUNTERS; c++)
+                if (pool->counters[w].fds[c] >= 0)
+                    close(pool->counters[w].fds[c]);
+
+        delete[] pool->counters;
+    }
+
+    delete[] pool->threads;
+    delete[] pool->placement;
+}
+
+// Has every worker open its hardware counters (one task per worker, so each
+// opens them for itself), and from then on accumulate them over its tasks.
+// Fills available[c] with whether event c could be opened on all workers;
+// returns the errno of a failed cycles event (0 if it opened everywhere).
+inline int poolEnableCounters(WorkerPool* pool, bool* available)
+{
+    ThreadCounters* counters = new ThreadCounters[pool->numThreads];
+
+    poolRun(pool, openCountersThread, counters, sizeof(ThreadCounters), pool->numThreads);
+
+    for (int c = 0; c < NUM_COUNTERS; c++) 
+    {
+        available[c] = true;
+
+        for (int w = 0; w < pool->numThreads; w++)
+            available[c] = available[c] && counters[w].fds[c] >= 0;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+
+    pool->counters = counters;
+
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int w = 0; w < pool->numThreads; w++)
+        if (counters[w].cyclesError != 0)
+            return counters[w].cyclesError;
+
+    return 0;
+}
+
+// Per-stage profile of the pool: a stage brackets one or more jobs, and
+// stores the wall-clock time and each worker's counts spent in it. With
+// counters not permitted (perf_event_paranoid) or not provided by the PMU,
+// the report degrades to wall-clock time only.
+struct StageProfile 
+{
+    const char* name;
+    long elements;       // Elements processed, for the per-element rates
+    double seconds;      // Wall-clock time
+    uint64_t* counts;    // numThreads × NUM_COUNTERS, per worker
+    bool multiplexed;    // Some event was time-sliced: its counts are scaled estimates
+};
+
+struct CounterProfile 
+{
+    bool enabled;                    // --counters given
+    bool available[NUM_COUNTERS];    // Events opened on every worker
+    int numThreads;
+    StageProfile stages[MAX_PROFILE_STAGES];
+    int numStages;
+
+    // Current stage
+    chrono::steady_clock::time_point start;
+    uint64_t* snapshot;              // Accumulated counts at stageBegin
+    long multiplexedSnapshot;        // Multiplexed jobs of all workers at stageBegin
+};
+
+inline void profileCreate(CounterProfile* profile, WorkerPool* pool, bool enabled)
+{
+    profile->enabled = enabled;
+    profile->numThreads = pool->numThreads;
+    profile->numStages = 0;
+    profile->snapshot = NULL;
+
+    if (!enabled)
+        return;
+
+    int error = poolEnableCounters(pool, profile->available);
+
+    profile->snapshot = new uint64_t[pool->numThreads * NUM_COUNTERS];
+
+    if (!profile->available[CTR_CYCLES]) 
+    {
+        int paranoid = -1;
+        ifstream setting("/proc/sys/kernel/perf_event_paranoid");
+
+        setting >> paranoid;
+
+        cout << "> Hardware counters unavailable (" << strerror(error) << ", perf_event_paranoid = " << paranoid 
+             << "); reporting wall-clock time only" << endl;
+    }
+}
+
+inline void stageBegin(CounterProfile* profile, WorkerPool* pool)
+{
+    if (!profile->enabled)
+        return;
+
+    profile->multiplexedSnapshot = 0;
+
+    for (int w = 0; w < profile->numThreads; w++) 
+    {
+        for (int c = 0; c < NUM_COUNTERS; c++)
+            profile->snapshot[w * NUM_COUNTERS + c] = pool->counters[w].accumulated[c];
+
+        profile->multiplexedSnapshot += pool->counters[w].multiplexed;
+    }
+
+    profile->start = chrono::steady_clock::now();
+}
+
+inline void stageEnd(CounterProfile* profile, WorkerPool* pool, const char* name, long elements)
+{
+    if (!profile->enabled || profile->numStages == MAX_PROFILE_STAGES)
+        return;
+
+    StageProfile* stage = &profile->stages[profile->numStages++];
+
+    stage->name = name;
+    stage->elements = elements;
+    stage->seconds = chrono::duration<double>(chrono::steady_clock::now() - profile->start).count();
+    stage->counts = new uint64_t[profile->numThreads * NUM_COUNTERS];
+
+    long multiplexed = 0;
+
+    for (int w = 0; w < profile->numThreads; w++) 
+    {
+        for (int c = 0; c < NUM_COUNTERS; c++)
+            stage->counts[w * NUM_COUNTERS + c] = pool->counters[w].accumulated[c] - profile->snapshot[w * NUM_COUNTERS + c];
+
+        multiplexed += pool->counters[w].multiplexed;
+    }
+
+    stage->multiplexed = (multiplexed > profile->multiplexedSnapshot);
+}
+
+// Prints one row of the report: counts of one worker, or summed over all.
+inline void printCounterRow(const CounterProfile* profile, const StageProfile* stage, const char* name, const char* label, 
+                     const uint64_t* counts)
+{
+    cout << "  " << left << setw(26) << name << right << setw(6) << label;
+
+    cout << fixed << setprecision(3) << setw(10) << stage->seconds * 1e3;
+
+    if (!profile->available[CTR_CYCLES]) 
+    {
+        cout << defaultfloat << endl;
+
+        return;
+    }
+
+    cout << setw(12) << counts[CTR_CYCLES] / 1e6;
+
+    if (profile->available[CTR_INSTRUCTIONS])
+        cout << setw(12) << counts[CTR_INSTRUCTIONS] / 1e6 << setw(7) << setprecision(2) 
+             << (counts[CTR_CYCLES] > 0 ? (double) counts[CTR_INSTRUCTIONS] / counts[CTR_CYCLES] : 0.0);
+    else
+        cout << setw(12) << "n/a" << setw(7) << "n/a";
+
+    for (int c = CTR_L1D_MISSES; c < NUM_COUNTERS; c++) 
+    {
+        if (profile->available[c])
+            cout << setw(12) << setprecision(4) << (double) counts[c] / stage->elements;
+        else
+            cout << setw(12) << "n/a";
+    }
+
+    cout << defaultfloat << endl;
+}
+
+// Per-stage table: a row summed over the workers, then one row per worker.
+// IPC is instructions per cycle; misses are per element of the stage.
+// Stages in which some event was multiplexed are marked with *.
+inline void printCounterReport(const CounterProfile* profile)
+{
+    if (!profile->enabled)
+        return;
+
+    cout << "\n> Hardware counters per stage (all workers, then per worker):" << endl;
+    cout << "  " << left << setw(26) << "stage" << right << setw(6) << "thread" << setw(10) << "ms";
+
+    if (profile->available[CTR_CYCLES])
+        cout << setw(12) << "Mcycles" << setw(12) << "Minstr" << setw(7) << "IPC" 
+             << setw(12) << "L1d/elt" << setw(12) << "LLC/elt" << setw(12) << "dTLB/elt";
+
+    cout << endl;
+
+    uint64_t total[NUM_COUNTERS];
+    bool multiplexed = false;
+
+    for (int s = 0; s < profile->numStages; s++) 
+    {
+        const StageProfile* stage = &profile->stages[s];
+
+        for (int c = 0; c < NUM_COUNTERS; c++) 
+        {
+            total[c] = 0;
+
+            for (int w = 0; w < profile->numThreads; w++)
+                total[c] += stage->counts[w * NUM_COUNTERS + c];
+        }
+
+        string name = stage->multiplexed ? string(stage->name) + " *" : string(stage->name);
+
+        multiplexed = multiplexed || stage->multiplexed;
+
+        printCounterRow(profile, stage, name.c_str(), "all", total);
+
+        if (!profile->available[CTR_CYCLES])
+            continue;
+
+        for (int w = 0; w < profile->numThreads; w++) 
+        {
+            string label = to_string(w);
+
+            printCounterRow(profile, stage, "", label.c_str(), &stage->counts[w * NUM_COUNTERS]);
+        }
+    }
+
+    if (multiplexed)
+        cout << "  * events time-sliced on the PMU: counts scaled by time enabled / time running" << endl;
+}
+
+inline void profileDestroy(CounterProfile* profile)
+{
+    for (int s = 0; s < profile->numStages; s++)
+        delete[] profile->stages[s].counts;
+
+    delete[] profile->snapshot;
+}
+
+// -----------------------------
+// Work Distribution
+// -----------------------------
+// A kernel numbers its work in total units and every task pulls ranges of
+// units with nextRange until it returns false. The policy decides the ranges:
+//   DIST_BLOCK:        one contiguous range per thread,
+//   DIST_CYCLIC:       single units, dealt round-robin,
+//   DIST_BLOCK_CYCLIC: ranges of chunk units, dealt round-robin,
+//   DIST_DYNAMIC:      ranges of chunk units, claimed from a shared counter by
+//                      whichever thread is free first (self-scheduling).
+// Only the dynamic policy touches shared state, and only once per range.
+
+// Sets the policy and rewinds the dynamic counter (required before every job).
+inline void setDistribution(Distribution* dist, DistributionPolicy policy, long chunk)
+{
+    dist->policy = policy;
+    dist->chunk = (chunk > 0) ? chunk : 1;
+    dist->next.store(0);
+}
+
+// Rewinds the dynamic counter so that the distribution can serve a new job.
+inline void resetDistribution(Distribution* dist)
+{
+    dist->next.store(0);
+}
+
+// Hands out this thread's next range [*first, *last) of the total units.
+// step is the caller's cursor, initialized to 0 before the first call.
+inline bool nextRange(Distribution* dist, int thread_id, int numThreads, long total, long* step, long* first, long* last)
+{
+    long start, chunk;
+
+    switch (dist->policy) 
+    {
+        case DIST_BLOCK:
+            if (*step > 0)
+                return false;
+
+            *step = 1;
+            *first = total * thread_id / numThreads;
+            *last = total * (thread_id + 1) / numThreads;
+
+            return *first < *last;
+
+        case DIST_DYNAMIC:
+            chunk = dist->chunk;
+            start = dist->next.fetch_add(chunk);
+
+            break;
+
+        default:  // DIST_CYCLIC, DIST_BLOCK_CYCLIC
+            chunk = (dist->policy == DIST_CYCLIC) ? 1 : dist->chunk;
+            start = (*step * numThreads + thread_id) * chunk;
+
+            (*step)++;
+
+            break;
+    }
+
+    if (start >= total)
+        return false;
+
+    *first = start;
+    *last = (start + chunk < total) ? start + chunk : total;
+
+    return true;
+}
+
+const char* policyName(DistributionPolicy policy)
+{
+    switch (policy) 
+    {
+        case DIST_CYCLIC: return "cyclic";
+        case DIST_BLOCK_CYCLIC: return "block-cyclic";
+        case DIST_DYNAMIC: return "dynamic";
+        default: return "block";
+    }
+}
+
+// Parses a policy name as printed by policyName; returns false if unknown.
+inline bool parsePolicy(const char* name, DistributionPolicy* policy)
+{
+    const DistributionPolicy all[] = { DIST_BLOCK, DIST_CYCLIC, DIST_BLOCK_CYCLIC, DIST_DYNAMIC };
+
+    for (int i = 0; i < 4; i++) 
+    {
+        if (strcmp(name, policyName(all[i])) == 0) 
+        {
+            *policy = all[i];
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Runs job(dist) under every candidate policy (best of TUNE_REPETITIONS
+// timed runs, after one warm-up) and leaves the fastest in best.
+template <typename Job>
+void tuneDistribution(const char* kernel, Distribution* best, Job job)
+{
+    const DistributionPolicy policies[] = { DIST_BLOCK, DIST_CYCLIC, DIST_BLOCK_CYCLIC, DIST_BLOCK_CYCLIC,
+                                            DIST_BLOCK_CYCLIC, DIST_DYNAMIC, DIST_DYNAMIC, DIST_DYNAMIC };
+    const long chunks[] = { 1, 1, 4, 16, 64, 4, 16, 64 };
+    const int numCandidates = 8;
+
+    Distribution candidate;
+
+    double bestSeconds = INFINITY, blockSeconds = INFINITY;
+    int bestIndex = 0;
+
+    for (int c = 0; c < numCandidates; c++) 
+    {
+        setDistribution(&candidate, policies[c], chunks[c]);
+
+        job(&candidate);
+
+        double seconds = INFINITY;
+
+        for (int r = 0; r < TUNE_REPETITIONS; r++) 
+        {
+            auto start = chrono::steady_clock::now();
+
+            job(&candidate);
+
+            double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+            if (elapsed < seconds)
+                seconds = elapsed;
+        }
+
+        if (c == 0)
+            blockSeconds = seconds;
+
+        if (seconds < bestSeconds) 
+        {
+            bestSeconds = seconds;
+            bestIndex = c;
+        }
+    }
+
+    setDistribution(best, policies[bestIndex], chunks[bestIndex]);
+
+    cout << "   " << kernel << ": " << policyName(best->policy);
+
+    if (best->policy == DIST_BLOCK_CYCLIC || best->policy == DIST_DYNAMIC)
+        cout << " (block size " << best->chunk << ")";
+
+    cout << ", " << bestSeconds * 1e3 << " ms (block: " << blockSeconds * 1e3 << " ms)" << endl;
+}
+
+// Deals the total elements of an element-wise job to the calling thread in
+// units of whole 64-byte lines (8 doubles or 16 floats), so every cache line
+// is read and written by exactly one thread; range(start, end) processes each
+// contiguous piece the thread is handed.
+template <typename T, typename Range>
+void forEachLineRange(Distribution* dist, int thread_id, int numThreads, long total, Range range)
+{
+    const long LINE = 64 / sizeof(T);
+
+    long lines = (total + LINE - 1) / LINE;
+    long step = 0, firstLine, lastLine;
+
+    while (nextRange(dist, thread_id, numThreads, lines, &step, &firstLine, &lastLine)) 
+    {
+        long start = firstLine * LINE, end = lastLine * LINE;
+
+        if (end > total)
+            end = total;
+
+        range(start, end);
+    }
+}
+
+// -----------------------------
+// Matrix Buffer Allocator
+// -----------------------------
+// Large matrix buffers are mapped directly: on explicit 2 MiB huge pages
+// (MAP_HUGETLB) when the system has them reserved, otherwise on 4 KiB pages
+// with a transparent-huge-page hint. Page placement across NUMA nodes is
+// either by parallel first touch (each pool worker zeroes the contiguous
+// slice it will later process) or round-robin interleaving via mbind.
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+enum PagePlacement { PLACE_FIRST_TOUCH, PLACE_INTERLEAVE };
+
+const PagePlacement BUFFER_PLACEMENT = PLACE_FIRST_TOUCH;
+
+struct MatrixBuffer 
+{
+    void* data;
+    size_t bytes;          // Mapped length (rounded up to the page size)
+    bool hugePages;        // true: MAP_HUGETLB; false: 4 KiB pages (+ MADV_HUGEPAGE)
+    bool interleaved;      // true: pages interleaved across all online nodes
+};
+
+// For the parallel first-touch task
+struct FirstTouchThreadData 
+{
+    int thread_id, numThreads;
+    char* base;            // Start of the mapping
+    size_t bytes;          // Length of the mapping
+    size_t pageSize;       // Slices are rounded to whole pages
+};
+
+// Thread function for first touch: zeroes this worker's contiguous share of
+// the pages, which makes the kernel allocate them on the worker's node.
+inline void* firstTouchThread(void* arg) 
+{
+    FirstTouchThreadData* data = (FirstTouchThreadData*) arg;
+
+    size_t pages = data->bytes / data->pageSize;
+    size_t first = pages * data->thread_id / data->numThreads;
+    size_t last = pages * (data->thread_id + 1) / data->numThreads;
+
+    if (last > first)
+        memset(data->base + first * data->pageSize, 0, (last - first) * data->pageSize);
+
+    return NULL;
+}
+
+// Reads the online NUMA nodes into a bit mask; returns the highest node + 1
+// (0 if the topology is not exposed).
+inline int readOnlineNodes(unsigned long* mask)
+{
+    *mask = 0;
+
+    ifstream online("/sys/devices/system/node/online");
+
+    string ranges;
+
+    if (!(online >> ranges))
+        return 0;
+
+    int maxNode = -1;
+    size_t pos = 0;
+
+    // Format: comma-separated ranges such as "0" or "0-1,4".
+    while (pos < ranges.size()) 
+    {
+        size_t comma = ranges.find(',', pos);
+        string range = ranges.substr(pos, comma == string::npos ? string::npos : comma - pos);
+
+        int lo = atoi(range.c_str()), hi = lo;
+        size_t dash = range.find('-');
+
+        if (dash != string::npos)
+            hi = atoi(range.c_str() + dash + 1);
+
+        for (int node = lo; node <= hi && node < (int) (8 * sizeof(unsigned long)); node++) 
+        {
+            *mask |= 1UL << node;
+            maxNode = node;
+        }
+
+        if (comma == string::npos)
+            break;
+
+        pos = comma + 1;
+    }
+
+    return maxNode + 1;
+}
+
+// Maps a zero-filled buffer of count elements of T and places its pages.
+// Without huge pages or NUMA support it falls back to plain pages with
+// default placement; only an out-of-memory mmap is fatal. Without a pool
+// (NULL) the pages are faulted in by whichever thread writes them first.
+template <typename T = double>
+T* allocateMatrix(MatrixBuffer* buffer, size_t count, PagePlacement placement, WorkerPool* pool)
+{
+    size_t bytes = count * sizeof(T);
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+
+    buffer->hugePages = false;
+    buffer->interleaved = false;
+
+    void* base = MAP_FAILED;
+
+    // Explicit huge pages are only worth it for at least one full huge page.
+    if (bytes >= HUGE_PAGE_SIZE) 
+    {
+        size_t hugeBytes = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+        base = mmap(NULL, hugeBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (base != MAP_FAILED) 
+        {
+            bytes = hugeBytes;
+            pageSize = HUGE_PAGE_SIZE;
+            buffer->hugePages = true;
+        }
+    }
+
+    if (base == MAP_FAILED) 
+    {
+        bytes = (bytes + pageSize - 1) / pageSize * pageSize;
+
+        base = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (base == MAP_FAILED) 
+        {
+            cerr << "Error: unable to map a matrix buffer of " << bytes << " bytes" << endl;
+
+            exit(-1);
+        }
+
+        // Ask for transparent huge pages; harmless where THP is disabled.
+        madvise(base, bytes, MADV_HUGEPAGE);
+    }
+
+    buffer->data = base;
+    buffer->bytes = bytes;
+
+    if (placement == PLACE_INTERLEAVE) 
+    {
+        unsigned long nodeMask;
+        int maxNode = readOnlineNodes(&nodeMask);
+
+        if (maxNode > 1)
+            buffer->interleaved = syscall(SYS_mbind, base, bytes, MPOL_INTERLEAVE, &nodeMask, maxNode + 1, 0) == 0;
+    }
+
+    if (pool == NULL)
+        return (T*) buffer->data;
+
+    // Faulting the pages in from the workers, in their processing slices
+    // (interleaved pages are faulted the same way, their node is fixed by the policy).
+    FirstTouchThreadData* touchData = new FirstTouchThreadData[pool->numThreads];
+
+    for (int t = 0; t < pool->numThreads; t++) 
+    {
+        touchData[t].thread_id = t;
+        touchData[t].numThreads = pool->numThreads;
+        touchData[t].base = (char*) base;
+        touchData[t].bytes = bytes;
+        touchData[t].pageSize = pageSize;
+    }
+
+    poolRun(pool, firstTouchThread, touchData, sizeof(FirstTouchThreadData), pool->numThreads);
+
+    delete[] touchData;
+
+    return (T*) buffer->data;
+}
+
+// Unmaps a buffer obtained from allocateMatrix.
+inline void releaseMatrix(MatrixBuffer* buffer)
+{
+    munmap(buffer->data, buffer->bytes);
+
+    buffer->data = NULL;
+    buffer->bytes = 0;
+}
+
+inline double computeDeterminant(MatrixView<const double> mat);
+
+// Determinant of a contiguous n×n matrix in row–major order.
+inline double computeDeterminant(const double* mat, int n)
+{
+    return computeDeterminant(squareView(mat, n));
+}
+
+// Recursive function to compute determinant of an n×n matrix (or a square
+// view into a larger one); the minors are built contiguous.
+inline double computeDeterminant(MatrixView<const double> mat) 
+{
+    int n = mat.rows;
+
+    if(n == 1)
+        return mat(0, 0);
+    if(n == 2)
+        return mat(0, 0)*mat(1, 1) - mat(0, 1)*mat(1, 0);
+
+    double det = 0.0;
+
+    // Allocatting temporary minor matrix of size (n-1)×(n-1)
+    double* minor = new double[(n - 1) * (n - 1)];
+
+    // Expanding along first row (row 0)
+    for (int col = 0; col < n; col++) 
+    {
+        // Building the minor by excluding row 0 and column 'col'
+        int minor_i = 0;
+    
+        for (int i = 1; i < n; i++) 
+        {
+            int minor_j = 0;
+            
+            for (int j = 0; j < n; j++) 
+            {
+                if(j == col)
+                    continue;
+            
+                minor[minor_i * (n - 1) + minor_j] = mat(i, j);
+            
+                minor_j++;
+            }
+            
+            minor_i++;
+        }
+
+        double sign = (col % 2 == 0) ? 1.0 : -1.0;
+        
+        det += sign * mat(0, col) * computeDeterminant(minor, n - 1);
+    }
+
+    delete[] minor;
+    
+    return det;
+}
+
+// Term of the cofactor expansion of a 6×6 matrix along row 0, for column col.
+inline double cofactorTerm(MatrixView<const double> matrix, int col) 
+{
+    int n = DET_SIZE, minor_size = n - 1; // = 5
+
+    // Building the minor (5×5) by excluding row 0 and column 'col'
+    double* minor = new double[minor_size * minor_size];
+
+    int minor_i = 0;
+    
+    for (int i = 1; i < n; i++) 
+    {
+        int minor_j = 0;
+    
+        for (int j = 0; j < n; j++) 
+        {
+            if(j == col)
+                continue;
+        
+            minor[minor_i * minor_size + minor_j] = matrix(i, j);
+        
+            minor_j++;
+        }
+
+        minor_i++;
+    }
+
+    double minorDet = computeDeterminant(minor, minor_size);
+    
+    delete[] minor;
+    
+    double sign = (col % 2 == 0) ? 1.0 : -1.0;
+    
+    return sign * matrix(0, col) * minorDet;
+}
+
+// Thread function for determinant computation
+// Each thread computes the terms of the expansion along row 0 for the
+// columns its distribution deals it; the partial sum is left in the
+// descriptor so that the caller can add them up.
+inline void* determinantThread(void* arg) 
+{
+    DetThreadData* data = (DetThreadData*) arg;
+
+    double sum = 0.0;
+    long step = 0, first, last;
+
+    while (nextRange(data->dist, data->thread_id, data->numThreads, DET_SIZE, &step, &first, &last)) 
+    {
+        for (long col = first; col < last; col++)
+            sum += cofactorTerm(data->matrix, (int) col);
+    }
+
+    data->result = sum;
+
+    return NULL;
+}
+
+// Determinant of a 6×6 matrix (or 6×6 view) by cofactor expansion, columns
+// spread over the pool.
+inline double parallelDeterminant(WorkerPool* pool, MatrixView<const double> matrix, Distribution* dist)
+{
+    if (matrix.rows != DET_SIZE || matrix.cols != DET_SIZE) 
+    {
+        cerr << "Error: the cofactor determinant takes a " << DET_SIZE << "x" << DET_SIZE << " matrix" << endl;
+
+        exit(-1);
+    }
+
+    int numThreads = pool->numThreads;
+
+    DetThreadData* detData = new DetThreadData[numThreads];
+
+    resetDistribution(dist);
+
+    for (int t = 0; t < numThreads; t++) 
+    {
+        detData[t].thread_id = t;
+        detData[t].numThreads = numThreads;
+        detData[t].matrix = matrix;
+        detData[t].dist = dist;
+    }
+
+    poolRun(pool, determinantThread, detData, sizeof(DetThreadData), numThreads);
+
+    // Summing the contributions of the threads.
+    double det = 0.0;
+
+    for (int t = 0; t < numThreads; t++)
+        det += detData[t].result;
+
+    delete[] detData;
+
+    return det;
+}
+
+inline double parallelDeterminant(WorkerPool* pool, const double* matrix, Distribution* dist)
+{
+    return parallelDeterminant(pool, squareView(matrix, DET_SIZE), dist);
+}
+
+// Thread function for the blocked LU factorization (PA = LU, partial pivoting).
+// All threads step through the panels together; for each panel of LU_BLOCK
+// columns:
+//   1. thread 0 factorizes the panel (rows k0..n-1) and records the pivots,
+//   2. every thread applies those row exchanges to its share of the columns
+//      outside the panel and, for trailing columns, solves U12 = L11^-1 A12,
+//   3. every thread updates its share of the trailing rows: A22 -= L21 U12.
+// L (unit diagonal, below) and U (on and above the diagonal) overwrite the input.
+inline void* luFactorizeThread(void* arg) 
+{
+    LUThreadData* data = (LUThreadData*) arg;
+
+    int thread_id = data->thread_id, numThreads = data->numThreads, n = data->n;
+    double* a = data->lu;
+    int* pivots = data->pivots;
+
+    for (int k0 = 0; k0 < n; k0 += LU_BLOCK) 
+    {
+        int kb = (k0 + LU_BLOCK < n) ? LU_BLOCK : n - k0;
+        int k1 = k0 + kb;
+
+        // 1. Panel factorization (unblocked, restricted to the panel columns).
+        if (thread_id == 0) 
+        {
+            for (int k = k0; k < k1; k++) 
+            {
+                int p = k;
+            
+                for (int i = k + 1; i < n; i++) 
+                {
+                    if (fabs(a[(long) i * n + k]) > fabs(a[(long) p * n + k]))
+                        p = i;
+                }
+
+                pivots[k] = p;
+
+                if (p != k) 
+                {
+                    for (int j = k0; j < k1; j++)
+                        swap(a[(long) k * n + j], a[(long) p * n + j]);
+                }
+
+                double pivot = a[(long) k * n + k];
+
+                if (pivot == 0.0)
+                    continue;  // Singular: the column is already zero below the diagonal
+
+                for (int i = k + 1; i < n; i++) 
+                {
+                    double l = a[(long) i * n + k] /= pivot;
+
+                    for (int j = k + 1; j < k1; j++)
+                        a[(long) i * n + j] -= l * a[(long) k * n + j];
+                }
+            }
+        }
+
+        pthread_barrier_wait(data->barrier);
+
+        // 2. Row exchanges and U12 for this thread's columns outside the panel.
+        int outside = n - kb;
+        int firstCol = (long) outside * thread_id / numThreads;
+        int lastCol = (long) outside * (thread_id + 1) / numThreads;
+
+        for (int c = firstCol; c < lastCol; c++) 
+        {
+            int j = (c < k0) ? c : c + kb;
+
+            for (int k = k0; k < k1; k++) 
+            {
+                if (pivots[k] != k)
+                    swap(a[(long) k * n + j], a[(long) pivots[k] * n + j]);
+            }
+
+            if (j < k1)
+                continue;
+
+            for (int k = k0; k < k1; k++) 
+            {
+                double u = a[(long) k * n + j];
+
+                for (int i = k + 1; i < k1; i++)
+                    a[(long) i * n + j] -= a[(long) i * n + k] * u;
+            }
+        }
+
+        pthread_barrier_wait(data->barrier);
+
+        // 3. Trailing update, split by rows.
+        int trailing = n - k1;
+        int firstRow = k1 + (int) ((long) trailing * thread_id / numThreads);
+        int lastRow = k1 + (int) ((long) trailing * (thread_id + 1) / numThreads);
+
+        for (int i = firstRow; i < lastRow; i++) 
+        {
+            double* row = &a[(long) i * n];
+
+            for (int k = k0; k < k1; k++) 
+            {
+                double l = row[k];
+                const double* u = &a[(long) k * n];
+
+                for (int j = k1; j < n; j++)
+                    row[j] -= l * u[j];
+            }
+        }
+
+        pthread_barrier_wait(data->barrier);
+    }
+
+    return NULL;
+}
+
+// Factorizes the n×n row-major matrix lu in place on the pool's workers.
+inline void luFactorize(WorkerPool* pool, double* lu, int* pivots, int n)
+{
+    int numThreads = pool->numThreads;
+
+    pthread_barrier_t barrier;
+
+    pthread_barrier_init(&barrier, NULL, numThreads);
+
+    LUThreadData* luData = new LUThreadData[numThreads];
+
+    for (int t = 0; t < numThreads; t++) 
+    {
+        luData[t].thread_id = t;
+        luData[t].numThreads = numThreads;
+        luData[t].n = n;
+        luData[t].lu = lu;
+        luData[t].pivots = pivots;
+        luData[t].barrier = &barrier;
+    }
+
+    poolRun(pool, luFactorizeThread, luData, sizeof(LUThreadData), numThreads);
+
+    pthread_barrier_destroy(&barrier);
+
+    delete[] luData;
+}
+
+// Reads sign and log|det| off a factorization: det(A) = (-1)^swaps * prod u_kk.
+inline LogDeterminant luLogDeterminant(const double* lu, const int* pivots, int n)
+{
+    LogDeterminant result = { 1, 0.0 };
+
+    for (int k = 0; k < n; k++) 
+    {
+        double u = lu[(long) k * n + k];
+
+        if (u == 0.0) 
+        {
+            result.sign = 0;
+            result.logAbs = -INFINITY;
+
+            return result;
+        }
+
+        if ((u < 0) != (pivots[k] != k))
+            result.sign = -result.sign;
+
+        result.logAbs += log(fabs(u));
+    }
+
+    return result;
+}
+
+// A factorization PA = LU kept for reuse: factor once with luCreate, then
+// read the determinant, solve any number of right-hand sides and invert
+// without refactorizing.
+struct LUFactorization 
+{
+    int n;
+    double* lu;
+    int* pivots;
+};
+
+// Factorizes a copy of the square matrix (or view) mat, left untouched, on
+// the pool. The copy is the factorization's own storage.
+inline void luCreate(WorkerPool* pool, LUFactorization* factors, MatrixView<const double> mat)
+{
+    int n = mat.rows;
+
+    factors->n = n;
+    factors->lu = new double[(long) n * n];
+    factors->pivots = new int[n];
+
+    for (int i = 0; i < n; i++)
+        memcpy(&factors->lu[(long) i * n], &mat(i, 0), n * sizeof(double));
+
+    luFactorize(pool, factors->lu, factors->pivots, n);
+}
+
+inline void luRelease(LUFactorization* factors)
+{
+    delete[] factors->lu;
+    delete[] factors->pivots;
+}
+
+// Log-determinant of a square matrix (or view, left untouched) via the
+// parallel blocked LU.
+inline LogDeterminant logDeterminant(WorkerPool* pool, MatrixView<const double> mat)
+{
+    LUFactorization factors;
+
+    luCreate(pool, &factors, mat);
+
+    LogDeterminant result = luLogDeterminant(factors.lu, factors.pivots, factors.n);
+
+    luRelease(&factors);
+
+    return result;
+}
+
+inline LogDeterminant logDeterminant(WorkerPool* pool, const double* mat, int n)
+{
+    return logDeterminant(pool, squareView(mat, n));
+}
+
+// Thread function for the triangular solves: each right-hand side is
+// independent, so the threads take whole cache lines of columns of B and
+// run, on those columns only, the row exchanges, forward substitution with
+// the unit L and back substitution with U. The inner loops run along a row
+// of B, over contiguous columns.
+inline void* luSolveThread(void* arg) 
+{
+    LUSolveThreadData* data = (LUSolveThreadData*) arg;
+
+    int n = data->n, nrhs = data->nrhs;
+    const double* lu = data->lu;
+    const int* pivots = data->pivots;
+    double* b = data->b;
+
+    forEachLineRange<double>(data->dist, data->thread_id, data->numThreads, nrhs, [&](long start, long end) {
+        // PB
+        for (int k = 0; k < n; k++) 
+        {
+            if (pivots[k] != k) 
+            {
+                for (long j = start; j < end; j++)
+                    swap(b[(long) k * nrhs + j], b[(long) pivots[k] * nrhs + j]);
+            }
+        }
+
+        // LY = PB
+        for (int i = 1; i < n; i++) 
+        {
+            double* row = &b[(long) i * nrhs];
+
+            for (int k = 0; k < i; k++) 
+            {
+                double l = lu[(long) i * n + k];
+                const double* y = &b[(long) k * nrhs];
+
+                for (long j = start; j < end; j++)
+                    row[j] -= l * y[j];
+            }
+        }
+
+        // UX = Y
+        for (int i = n - 1; i >= 0; i--) 
+        {
+            double* row = &b[(long) i * nrhs];
+
+            for (int k = i + 1; k < n; k++) 
+            {
+                double u = lu[(long) i * n + k];
+                const double* x = &b[(long) k * nrhs];
+
+                for (long j = start; j < end; j++)
+                    row[j] -= u * x[j];
+            }
+
+            double diagonal = lu[(long) i * n + i];
+
+            for (long j = start; j < end; j++)
+                row[j] /= diagonal;
+        }
+    });
+
+    return NULL;
+}
+
+// Solves AX = B for the nrhs columns of the n×nrhs row-major matrix b
+// (overwritten by X) with an existing factorization of A, on the pool.
+inline void luSolve(WorkerPool* pool, const LUFactorization* factors, double* b, int nrhs, Distribution* dist)
+{
+    int numThreads = pool->numThreads;
+
+    LUSolveThreadData* solveData = new LUSolveThreadData[numThreads];
+
+    resetDistribution(dist);
+
+    for (int t = 0; t < numThreads; t++) 
+    {
+        solveData[t].thread_id = t;
+        solveData[t].numThreads = numThreads;
+        solveData[t].n = factors->n;
+        solveData[t].nrhs = nrhs;
+        solveData[t].lu = factors->lu;
+        solveData[t].pivots = factors->pivots;
+        solveData[t].b = b;
+        solveData[t].dist = dist;
+    }
+
+    poolRun(pool, luSolveThread, solveData, sizeof(LUSolveThreadData), numThreads);
+
+    delete[] solveData;
+}
+
+// Explicit inverse: solves AX = I, all n columns at once.
+inline void luInverse(WorkerPool* pool, const LUFactorization* factors, double* inverse, Distribution* dist)
+{
+    int n = factors->n;
+
+    memset(inverse, 0, (size_t) n * n * sizeof(double));
+
+    for (int i = 0; i < n; i++)
+        inverse[(long) i * n + i] = 1.0;
+
+    luSolve(pool, factors, inverse, n, dist);
+}
+
+// Sequential (golden) log-determinant: textbook Gaussian elimination with
+// partial pivoting, one column at a time.
+inline LogDeterminant sequentialLogDeterminant(MatrixView<const double> mat)
+{
+    int n = mat.rows;
+
+    double* a = new double[(long) n * n];
+
+    for (int i = 0; i < n; i++)
+        memcpy(&a[(long) i * n], &mat(i, 0), n * sizeof(double));
+
+    LogDeterminant result = { 1, 0.0 };
+
+    for (int k = 0; k < n && result.sign != 0; k++) 
+    {
+        int p = k;
+
+        for (int i = k + 1; i < n; i++) 
+        {
+            if (fabs(a[(long) i * n + k]) > fabs(a[(long) p * n + k]))
+                p = i;
+        }
+
+        if (a[(long) p * n + k] == 0.0) 
+        {
+            result.sign = 0;
+            result.logAbs = -INFINITY;
+
+            break;
+        }
+
+        if (p != k) 
+        {
+            for (int j = 0; j < n; j++)
+                swap(a[(long) k * n + j], a[(long) p * n + j]);
+
+            result.sign = -result.sign;
+        }
+
+        double pivot = a[(long) k * n + k];
+
+        if (pivot < 0)
+            result.sign = -result.sign;
+
+        result.logAbs += log(fabs(pivot));
+
+        for (int i = k + 1; i < n; i++) 
+        {
+            double l = a[(long) i * n + k] / pivot;
+
+            for (int j = k + 1; j < n; j++)
+                a[(long) i * n + j] -= l * a[(long) k * n + j];
+        }
+    }
+
+    delete[] a;
+
+    return result;
+}
+
+inline LogDeterminant sequentialLogDeterminant(const double* mat, int n)
+{
+    return sequentialLogDeterminant(squareView(mat, n));
+}
+
+// Determinant of an N×N matrix by Gaussian elimination with partial pivoting,
+// for V = double or SimdVec<double> (one matrix per lane). Pivot choice and
+// row exchanges are made per lane with selects, so all lanes follow the same
+// instruction stream. a is overwritten. N is a compile-time constant: the
+// loops unroll completely and nothing is allocated.
+template <int N, typename V>
+inline V smallDeterminant(V a[N][N])
+{
+    V det = V(1.0);
+
+    #pragma GCC unroll 8
+    for (int k = 0; k < N; k++) 
+    {
+        // Pivot search: pivotRow holds, per lane, the row of the largest |a[i][k]|.
+        V best = simdAbs(a[k][k]);
+        V pivotRow = V((double) k);
+
+        #pragma GCC unroll 8
+        for (int i = k + 1; i < N; i++) 
+        {
+            V candidate = simdAbs(a[i][k]);
+
+            auto better = simdGreater(candidate, best);
+
+            best = simdSelect(better, candidate, best);
+            pivotRow = simdSelect(better, V((double) i), pivotRow);
+        }
+
+        // Row exchange in the lanes whose pivot is row i.
+        #pragma GCC unroll 8
+        for (int i = k + 1; i < N; i++) 
+        {
+            auto exchange = simdEqual(pivotRow, V((double) i));
+
+            #pragma GCC unroll 8
+            for (int j = k; j < N; j++) 
+            {
+                V rowK = a[k][j];
+
+                a[k][j] = simdSelect(exchange, a[i][j], rowK);
+                a[i][j] = simdSelect(exchange, rowK, a[i][j]);
+            }
+
+            det = simdSelect(exchange, V(0.0) - det, det);
+        }
+
+        V pivot = a[k][k];
+
+        det = det * pivot;
+
+        // A zero pivot already made the lane's determinant 0; dividing by 1
+        // instead keeps the lane free of NaNs.
+        V inverse = V(1.0) / simdSelect(simdEqual(pivot, V(0.0)), V(1.0), pivot);
+
+        #pragma GCC unroll 8
+        for (int i = k + 1; i < N; i++) 
+        {
+            V factor = a[i][k] * inverse;
+
+            #pragma GCC unroll 8
+            for (int j = k + 1; j < N; j++)
+                a[i][j] = a[i][j] - factor * a[k][j];
+        }
+    }
+
+    return det;
+}
+
+// Determinants of tiles [first, last) of an SoA batch of count N×N tiles.
+// Full vectors of consecutive tiles run one tile per lane; the remainder
+// goes through the scalar instantiation.
+template <int N>
+void batchDeterminantRange(const double* tiles, long count, long first, long last, double* dets)
+{
+    const int W = SimdVec<double>::WIDTH;
+
+    long b = first;
+
+    for (; b + W <= last; b += W) 
+    {
+        SimdVec<double> a[N][N];
+
+        for (int i = 0; i < N; i++)
+            for (int j = 0; j < N; j++)
+                a[i][j] = simdLoad(&tiles[(long) (i * N + j) * count + b]);
+
+        simdStore(&dets[b], smallDeterminant<N>(a));
+    }
+
+    for (; b < last; b++) 
+    {
+        double a[N][N];
+
+        for (int i = 0; i < N; i++)
+            for (int j = 0; j < N; j++)
+                a[i][j] = tiles[(long) (i * N + j) * count + b];
+
+        dets[b] = smallDeterminant<N>(a);
+    }
+}
+
+// Thread function for batched determinants. The batch is dealt in units of
+// 8 tiles, so the threads' SoA slices and their outputs never share a cache line.
+inline void* batchDeterminantThread(void* arg) 
+{
+    BatchDetThreadData* data = (BatchDetThreadData*) arg;
+
+    int size = data->size;
+    long count = data->count;
+
+    const long LINE = 64 / sizeof(double);
+
+    long lines = (count + LINE - 1) / LINE;
+    long step = 0, firstLine, lastLine;
+
+    while (nextRange(data->dist, data->thread_id, data->numThreads, lines, &step, &firstLine, &lastLine)) 
+    {
+        long first = firstLine * LINE, last = lastLine * LINE;
+
+        if (last > count)
+            last = count;
+
+        // Cutting this range's tiles out of the source matrix (tiles are
+        // numbered row-major over the grid of non-overlapping size×size tiles).
+        if (data->matrix != NULL) 
+        {
+            int n = data->n, tilesPerRow = n / size;
+
+            for (long b = first; b < last; b++) 
+            {
+                const double* tile = &data->matrix[(long) (b / tilesPerRow) * size * n + (b % tilesPerRow) * size];
+
+                for (int i = 0; i < size; i++)
+                    for (int j = 0; j < size; j++)
+                        data->tiles[(long) (i * size + j) * count + b] = tile[(long) i * n + j];
+            }
+        }
+
+        switch (size) 
+        {
+            case 2: batchDeterminantRange<2>(data->tiles, count, first, last, data->dets); break;
+            case 3: batchDeterminantRange<3>(data->tiles, count, first, last, data->dets); break;
+            case 4: batchDeterminantRange<4>(data->tiles, count, first, last, data->dets); break;
+            case 5: batchDeterminantRange<5>(data->tiles, count, first, last, data->dets); break;
+            case 6: batchDeterminantRange<6>(data->tiles, count, first, last, data->dets); break;
+            case 7: batchDeterminantRange<7>(data->tiles, count, first, last, data->dets); break;
+            case 8: batchDeterminantRange<8>(data->tiles, count, first, last, data->dets); break;
+            default: break;
+        }
+    }
+
+    return NULL;
+}
+
+// Computes the determinants of count size×size tiles (2 <= size <= 8).
+// With matrix != NULL the batch is every non-overlapping tile of the n×n
+// matrix (count = (n / size)², row-major over the tile grid), cut into the
+// caller's SoA buffer tiles (size*size*count doubles) by the worker threads;
+// otherwise tiles must already hold the SoA batch.
+inline void batchDeterminant(WorkerPool* pool, const double* matrix, int n, int size, double* tiles, long count, double* dets,
+                      Distribution* dist)
+{
+    if (size < 2 || size > 8) 
+    {
+        cerr << "Error: batched determinant supports tile sizes 2..8, got " << size << endl;
+
+        exit(-1);
+    }
+
+    int numThreads = pool->numThreads;
+
+    BatchDetThreadData* batchData = new BatchDetThreadData[numThreads];
+
+    resetDistribution(dist);
+
+    for (int t = 0; t < numThreads; t++) 
+    {
+        batchData[t].thread_id = t;
+        batchData[t].numThreads = numThreads;
+        batchData[t].size = size;
+        batchData[t].count = count;
+        batchData[t].matrix = matrix;
+        batchData[t].n = n;
+        batchData[t].tiles = tiles;
+        batchData[t].dets = dets;
+        batchData[t].dist = dist;
+    }
+
+    poolRun(pool, batchDeterminantThread, batchData, sizeof(BatchDetThreadData), numThreads);
+
+    delete[] batchData;
+}
+
+// Hadamard's bound prod_i ||row_i||_2 >= |det|, the scale for determinant tolerances.
+inline double hadamardBound(MatrixView<const double> mat)
+{
+    double bound = 1.0;
+
+    for (int i = 0; i < mat.rows; i++) 
+    {
+        double rowNorm = 0.0;
+
+        for (int j = 0; j < mat.cols; j++)
+            rowNorm += mat(i, j) * mat(i, j);
+
+        bound *= sqrt(rowNorm);
+    }
+
+    return bound;
+}
+
+inline double hadamardBound(const double* mat, int n)
+{
+    return hadamardBound(squareView(mat, n));
+}
+
+// Natural logarithm of positive normal x, for V = double, float or a SimdVec
+// of either. x is reduced to 2^k * m with m in [sqrt(2)/2, sqrt(2)); with
+// f = m - 1 and s = f / (2 + f), log(m) = 2 atanh(s) is evaluated as a
+// polynomial in s².
+//   LOG_EXACT: fdlibm's minimax coefficients (double: |error| < 2^-58.45 on
+//              the reduced range; float: the shorter logf set, < 2^-34.24)
+//              with ln(2) split into high and low parts.
+//   LOG_FAST:  the atanh series truncated after s^9 (double) or s^7 (float),
+//              with a single ln(2) product. For double, truncation costs at
+//              most s^10 / 11 < 2.1e-9 of log(m) for |s| <= 0.1716, i.e. below
+//              7.1e-10 absolute since |log(m)| <= 0.347; for float at most
+//              s^8 / 9 < 8e-8 of log(m). The LOG_FAST_MAX_ERROR tolerances
+//              leave room for rounding.
+template <LogAccuracy TIER, typename V>
+inline V logPolynomial(V x)
+{
+    const bool SINGLE = sizeof(typename ElementOf<V>::type) == sizeof(float);
+
+    V m;
+    V k = simdSplitExponent(x, &m);
+
+    auto aboveSqrt2 = simdGreater(m, V(1.4142135623730951));
+
+    m = simdSelect(aboveSqrt2, m * V(0.5), m);
+    k = simdSelect(aboveSqrt2, k + V(1.0), k);
+
+    V f = m - V(1.0);
+    V s = f / (f + V(2.0));
+    V z = s * s;
+
+    if (TIER == LOG_EXACT && SINGLE)
+    {
+        V w = z * z;
+        V t1 = w * (V(0.40000972152f) + w * V(0.24279078841f));
+        V t2 = z * (V(0.66666662693f) + w * V(0.28498786688f));
+        V r = t2 + t1;
+        V hfsq = V(0.5f) * f * f;
+
+        return k * V(6.9313812256e-01f) - ((hfsq - (s * (hfsq + r) + k * V(9.0580006145e-06f))) - f);
+    }
+
+    if (TIER == LOG_EXACT)
+    {
+        V w = z * z;
+        V t1 = w * (V(3.999999999940941908e-01) + w * (V(2.222219843214978396e-01) + w * V(1.531383769920937332e-01)));
+        V t2 = z * (V(6.666666666666735130e-01) + w * (V(2.857142874366239149e-01) +
+                    w * (V(1.818357216161805012e-01) + w * V(1.479819860511658591e-01))));
+        V r = t2 + t1;
+        V hfsq = V(0.5) * f * f;
+
+        // k*ln2_hi is exact; the low part and the correction are added to f last.
+        return k * V(6.93147180369123816490e-01) -
+               ((hfsq - (s * (hfsq + r) + k * V(1.90821492927058770002e-10))) - f);
+    }
+
+    if (SINGLE)
+    {
+        V series = V(1.0f) + z * (V(1.0f / 3.0f) + z * (V(1.0f / 5.0f) + z * V(1.0f / 7.0f)));
+
+        return k * V(6.93147180559945309417e-01f) + V(2.0f) * s * series;
+    }
+
+    V series = V(1.0) + z * (V(1.0 / 3.0) + z * (V(1.0 / 5.0) + z * (V(1.0 / 7.0) + z * V(1.0 / 9.0))));
+
+    return k * V(6.93147180559945309417e-01) + V(2.0) * s * series;
+}
+
+// Scalar logarithm of one element: special values (zero, negative, subnormal,
+// infinite, NaN) go to std::log, everything else through the tier's polynomial.
+template <LogAccuracy TIER, typename T>
+inline T logScalar(T x)
+{
+    if (!(x >= numeric_limits<T>::min() && x <= numeric_limits<T>::max()))
+        return std::log(x);
+
+    return logPolynomial<TIER>(x);
+}
+
+// Logarithm of one vector. A vector that contains any special value falls
+// back to the scalar path for all of its lanes.
+template <LogAccuracy TIER, typename T>
+inline SimdVec<T> logVector(SimdVec<T> x)
+{
+    if (!simdAny(simdOutside(x, numeric_limits<T>::min(), numeric_limits<T>::max())))
+        return logPolynomial<TIER>(x);
+
+    T lanes[SimdVec<T>::WIDTH];
+
+    simdStore(lanes, x);
+
+    for (int lane = 0; lane < SimdVec<T>::WIDTH; lane++)
+        lanes[lane] = logScalar<TIER>(lanes[lane]);
+
+    return simdLoad(lanes);
+}
+
+// Applies the logarithm to count contiguous elements.
+template <LogAccuracy TIER, typename T>
+void logRange(const T* input, T* output, long count)
+{
+    const int W = SimdVec<T>::WIDTH;
+
+    long i = 0;
+
+    for (; i + W <= count; i += W)
+        simdStore(&output[i], logVector<TIER>(simdLoad(&input[i])));
+
+    for (; i < count; i++)
+        output[i] = logScalar<TIER>(input[i]);
+}
+
+// Element-wise operations that can be fused into the transpose, callable on
+// a whole vector or on a single element.
+struct IdentityOp 
+{
+    template <typename V> V operator()(V x) const { return x; }
+};
+
+template <LogAccuracy TIER>
+struct LogOp 
+{
+    template <typename T> SimdVec<T> operator()(SimdVec<T> x) const { return logVector<TIER>(x); }
+    template <typename T> T operator()(T x) const { return logScalar<TIER>(x); }
+};
+
+// Plain-loop version of the block kernel (scalar builds, and the reference
+// shape of what the vector kernels below compute).
+template <typename T, typename Op>
+inline void transposeKernelScalar(const T* in, long ldIn, T* out, long ldOut, Op op)
+{
+    const int K = TransposeKernel<T>::EDGE;
+
+    for (int r = 0; r < K; r++)
+    {
+        for (int c = 0; c < K; c++)
+            out[c * ldOut + r] = op(in[r * ldIn + c]);
+    }
+}
+
+// Transposes one K×K block (K = TransposeKernel<T>::EDGE) held in registers:
+// out[c][r] = op(in[r][c]). ldIn/ldOut are the row strides of the two matrices.
+// op is applied to each row right after it is loaded, so a fused element-wise
+// transform costs no extra memory traffic.
+template <typename Op>
+inline void transposeKernel(const double* in, long ldIn, double* out, long ldOut, Op op)
+{
+#if defined(__AVX512F__)
+    __m512d r0 = op(simdLoad(in + 0 * ldIn)).v;
+    __m512d r1 = op(simdLoad(in + 1 * ldIn)).v;
+    __m512d r2 = op(simdLoad(in + 2 * ldIn)).v;
+    __m512d r3 = op(simdLoad(in + 3 * ldIn)).v;
+    __m512d r4 = op(simdLoad(in + 4 * ldIn)).v;
+    __m512d r5 = op(simdLoad(in + 5 * ldIn)).v;
+    __m512d r6 = op(simdLoad(in + 6 * ldIn)).v;
+    __m512d r7 = op(simdLoad(in + 7 * ldIn)).v;
+
+    // Interleaving row pairs: t0 = [r0_0 r1_0 r0_2 r1_2 r0_4 r1_4 r0_6 r1_6], ...
+    __m512d t0 = _mm512_maskz_unpacklo_pd(SIMD_ALL_D, r0, r1);
+    __m512d t1 = _mm512_maskz_unpackhi_pd(SIMD_ALL_D, r0, r1);
+    __m512d t2 = _mm512_maskz_unpacklo_pd(SIMD_ALL_D, r2, r3);
+    __m512d t3 = _mm512_maskz_unpackhi_pd(SIMD_ALL_D, r2, r3);
+    __m512d t4 = _mm512_maskz_unpacklo_pd(SIMD_ALL_D, r4, r5);
+    __m512d t5 = _mm512_maskz_unpackhi_pd(SIMD_ALL_D, r4, r5);
+    __m512d t6 = _mm512_maskz_unpacklo_pd(SIMD_ALL_D, r6, r7);
+    __m512d t7 = _mm512_maskz_unpackhi_pd(SIMD_ALL_D, r6, r7);
+
+    // Gathering 128-bit lanes: u0 = [r0_0 r1_0 r2_0 r3_0 r0_4 r1_4 r2_4 r3_4], ...
+    const __m512i evenLanes = _mm512_set_epi64(13, 12, 5, 4, 9, 8, 1, 0);
+    const __m512i oddLanes = _mm512_set_epi64(15, 14, 7, 6, 11, 10, 3, 2);
+
+    __m512d u0 = _mm512_permutex2var_pd(t0, evenLanes, t2);
+    __m512d u1 = _mm512_permutex2var_pd(t0, oddLanes, t2);
+    __m512d u2 = _mm512_permutex2var_pd(t1, evenLanes, t3);
+    __m512d u3 = _mm512_permutex2var_pd(t1, oddLanes, t3);
+    __m512d u4 = _mm512_permutex2var_pd(t4, evenLanes, t6);
+    __m512d u5 = _mm512_permutex2var_pd(t4, oddLanes, t6);
+    __m512d u6 = _mm512_permutex2var_pd(t5, evenLanes, t7);
+    __m512d u7 = _mm512_permutex2var_pd(t5, oddLanes, t7);
+
+    // Joining the upper (rows 0-3) and lower (rows 4-7) halves of each column.
+    _mm512_storeu_pd(out + 0 * ldOut, _mm512_maskz_shuffle_f64x2(SIMD_ALL_D, u0, u4, 0x44));
+    _mm512_storeu_pd(out + 1 * ldOut, _mm512_maskz_shuffle_f64x2(SIMD_ALL_D, u2, u6, 0x44));
+    _mm512_storeu_pd(out + 2 * ldOut, _mm512_maskz_shuffle_f64x2(SIMD_ALL_D, u1, u5, 0x44));
+    _mm512_storeu_pd(out + 3 * ldOut, _mm512_maskz_shuffle_f64x2(SIMD_ALL_D, u3, u7, 0x44));
+    _mm512_storeu_pd(out + 4 * ldOut, _mm512_maskz_shuffle_f64x2(SIMD_ALL_D, u0, u4, 0xEE));
+    _mm512_storeu_pd(out + 5 * ldOut, _mm512_maskz_shuffle_f64x2(SIMD_ALL_D, u2, u6, 0xEE));
+    _mm512_storeu_pd(out + 6 * ldOut, _mm512_maskz_shuffle_f64x2(SIMD_ALL_D, u1, u5, 0xEE));
+    _mm512_storeu_pd(out + 7 * ldOut, _mm512_maskz_shuffle_f64x2(SIMD_ALL_D, u3, u7, 0xEE));
+#elif defined(__AVX2__)
+    __m256d r0 = op(simdLoad(in + 0 * ldIn)).v;
+    __m256d r1 = op(simdLoad(in + 1 * ldIn)).v;
+    __m256d r2 = op(simdLoad(in + 2 * ldIn)).v;
+    __m256d r3 = op(simdLoad(in + 3 * ldIn)).v;
+
+    // Interleaving row pairs: t0 = [r0_0 r1_0 r0_2 r1_2], t1 = [r0_1 r1_1 r0_3 r1_3], ...
+    __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+    __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+    __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+    __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+
+    // Joining the 128-bit halves into full columns.
+    _mm256_storeu_pd(out + 0 * ldOut, _mm256_permute2f128_pd(t0, t2, 0x20));
+    _mm256_storeu_pd(out + 1 * ldOut, _mm256_permute2f128_pd(t1, t3, 0x20));
+    _mm256_storeu_pd(out + 2 * ldOut, _mm256_permute2f128_pd(t0, t2, 0x31));
+    _mm256_storeu_pd(out + 3 * ldOut, _mm256_permute2f128_pd(t1, t3, 0x31));
+#else
+    transposeKernelScalar(in, ldIn, out, ldOut, op);
+#endif
+}
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+// Applies op to eight rows of eight floats. With AVX-512 a vector holds 16
+// floats, so rows are paired into one zmm register per call.
+template <typename Op>
+inline void applyRows(__m256* rows, Op op)
+{
+#if defined(__AVX512F__)
+    for (int r = 0; r < 8; r += 2)
+    {
+        __m512d pair = _mm512_maskz_insertf64x4(SIMD_ALL_D, _mm512_castpd256_pd512(_mm256_castps_pd(rows[r])), 
+                                                _mm256_castps_pd(rows[r + 1]), 1);
+
+        __m512 result = op(SimdVec<float>(_mm512_castpd_ps(pair))).v;
+
+        rows[r] = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(SIMD_ALL_D, _mm512_castps_pd(result), 0));
+        rows[r + 1] = _mm256_castpd_ps(_mm512_maskz_extractf64x4_pd(SIMD_ALL_D, _mm512_castps_pd(result), 1));
+    }
+#else
+    for (int r = 0; r < 8; r++)
+        rows[r] = op(SimdVec<float>(rows[r])).v;
+#endif
+}
+
+inline void applyRows(__m256* rows, IdentityOp op) { (void) rows; (void) op; }
+#endif
+
+template <typename Op>
+inline void transposeKernel(const float* in, long ldIn, float* out, long ldOut, Op op)
+{
+#if defined(__AVX2__) || defined(__AVX512F__)
+    __m256 r[8];
+
+    for (int i = 0; i < 8; i++)
+        r[i] = _mm256_loadu_ps(in + i * ldIn);
+
+    applyRows(r, op);
+
+    // Interleaving row pairs: t0 = [r0_0 r1_0 r0_1 r1_1 | r0_4 r1_4 r0_5 r1_5], ...
+    __m256 t0 = _mm256_unpacklo_ps(r[0], r[1]);
+    __m256 t1 = _mm256_unpackhi_ps(r[0], r[1]);
+    __m256 t2 = _mm256_unpacklo_ps(r[2], r[3]);
+    __m256 t3 = _mm256_unpackhi_ps(r[2], r[3]);
+    __m256 t4 = _mm256_unpacklo_ps(r[4], r[5]);
+    __m256 t5 = _mm256_unpackhi_ps(r[4], r[5]);
+    __m256 t6 = _mm256_unpacklo_ps(r[6], r[7]);
+    __m256 t7 = _mm256_unpackhi_ps(r[6], r[7]);
+
+    // Gathering four rows per column: u0 = [r0_0 r1_0 r2_0 r3_0 | r0_4 r1_4 r2_4 r3_4], ...
+    __m256 u0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+    __m256 u6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+    __m256 u7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+    // Joining the 128-bit halves of rows 0-3 and 4-7 into full columns.
+    _mm256_storeu_ps(out + 0 * ldOut, _mm256_permute2f128_ps(u0, u4, 0x20));
+    _mm256_storeu_ps(out + 1 * ldOut, _mm256_permute2f128_ps(u1, u5, 0x20));
+    _mm256_storeu_ps(out + 2 * ldOut, _mm256_permute2f128_ps(u2, u6, 0x20));
+    _mm256_storeu_ps(out + 3 * ldOut, _mm256_permute2f128_ps(u3, u7, 0x20));
+    _mm256_storeu_ps(out + 4 * ldOut, _mm256_permute2f128_ps(u0, u4, 0x31));
+    _mm256_storeu_ps(out + 5 * ldOut, _mm256_permute2f128_ps(u1, u5, 0x31));
+    _mm256_storeu_ps(out + 6 * ldOut, _mm256_permute2f128_ps(u2, u6, 0x31));
+    _mm256_storeu_ps(out + 7 * ldOut, _mm256_permute2f128_ps(u3, u7, 0x31));
+#else
+    transposeKernelScalar(in, ldIn, out, ldOut, op);
+#endif
+}
+
+// 32-bit integers move through the float kernel (a transpose only copies bits).
+template <typename Op>
+inline void transposeKernel(const int32_t* in, long ldIn, int32_t* out, long ldOut, Op op)
+{
+#if defined(__AVX2__) || defined(__AVX512F__)
+    transposeKernel((const float*) in, ldIn, (float*) out, ldOut, op);
+#else
+    transposeKernelScalar(in, ldIn, out, ldOut, op);
+#endif
+}
+
+// Transposes (and transforms by op) the tile whose top-left corner is
+// (rowStart, colStart) of the input into the output. Full register blocks go
+// through transposeKernel; the ragged right and bottom edges (when a
+// dimension is not a multiple of the kernel) are copied scalar.
+template <typename T, typename Op>
+void transposeTile(MatrixView<const T> input, MatrixView<T> output, int rowStart, int colStart, Op op)
+{
+    const int K = TransposeKernel<T>::EDGE;
+
+    int rowEnd = (rowStart + TRANSPOSE_TILE < input.rows) ? rowStart + TRANSPOSE_TILE : input.rows;
+    int colEnd = (colStart + TRANSPOSE_TILE < input.cols) ? colStart + TRANSPOSE_TILE : input.cols;
+
+    int i = rowStart;
+
+    for (; i + K <= rowEnd; i += K)
+    {
+        int j = colStart;
+
+        for (; j + K <= colEnd; j += K)
+            transposeKernel(&input(i, j), input.ld, &output(j, i), output.ld, op);
+
+        for (; j < colEnd; j++)
+        {
+            for (int r = i; r < i + K; r++)
+                output(j, r) = op(input(r, j));
+        }
+    }
+
+    for (; i < rowEnd; i++)
+    {
+        for (int j = colStart; j < colEnd; j++)
+            output(j, i) = op(input(i, j));
+    }
+}
+
+// Runs the tiles [firstTile, lastTile) of the band of numTileCols tile
+// columns starting at firstTileCol, numbered row-major within the band.
+template <typename T, typename Op>
+void transposeTileRange(MatrixView<const T> input, MatrixView<T> output, int firstTileCol, int numTileCols, 
+                        long firstTile, long lastTile, Op op)
+{
+    for (long tile = firstTile; tile < lastTile; tile++)
+    {
+        int tileRow = tile / numTileCols, tileCol = firstTileCol + tile % numTileCols;
+
+        transposeTile(input, output, tileRow * TRANSPOSE_TILE, tileCol * TRANSPOSE_TILE, op);
+    }
+}
+
+// Transposes every tile range the thread's distribution deals it.
+template <typename T, typename Op>
+void transposeDistributed(TransposeThreadData<T>* data, Op op)
+{
+    int tileRows = (data->input.rows + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+    long numTiles = (long) tileRows * data->numTileCols;
+
+    long step = 0, firstTile, lastTile;
+
+    while (nextRange(data->dist, data->thread_id, data->numThreads, numTiles, &step, &firstTile, &lastTile))
+        transposeTileRange(data->input, data->output, data->firstTileCol, data->numTileCols, firstTile, lastTile, op);
+}
+
+// Thread function for matrix transposition using cache-blocked tile distribution.
+// The tile grid is numbered row-major and threads receive whole tiles, so no
+// two threads ever write into the same output cache line (for a row count
+// and output stride that are multiples of 8) and every store stream stays
+// within a tile.
+// With a fused op the result is op(A)ᵀ = op(Aᵀ), produced in the same pass.
+template <typename T>
+void transposeWithOp(TransposeThreadData<T>* data)
+{
+    switch (data->op) 
+    {
+        case OP_LOG_EXACT: transposeDistributed(data, LogOp<LOG_EXACT>()); break;
+        case OP_LOG_FAST: transposeDistributed(data, LogOp<LOG_FAST>()); break;
+        default: transposeDistributed(data, IdentityOp()); break;
+    }
+}
+
+// Integers have no logarithm: only the plain transpose (checked by the launcher).
+inline void transposeWithOp(TransposeThreadData<int32_t>* data)
+{
+    transposeDistributed(data, IdentityOp());
+}
+
+template <typename T>
+void* transposeThread(void* arg) 
+{
+    transposeWithOp((TransposeThreadData<T>*) arg);
+
+    return NULL;
+}
+
+// Out-of-place transpose on the pool, restricted to the input columns of
+// tile columns [firstTileCol, firstTileCol + numTileCols), i.e. to output
+// rows in the same range: output = op(input)ᵀ on that band.
+template <typename T>
+void parallelTransposeBand(WorkerPool* pool, typename ReadView<T>::Type input, MatrixView<T> output, 
+                           int firstTileCol, int numTileCols, ElementwiseOp op, Distribution* dist)
+{
+    if (op != OP_IDENTITY && !numeric_limits<T>::is_iec559) 
+    {
+        cerr << "Error: element-wise log requested on an integer matrix" << endl;
+
+        exit(-1);
+    }
+
+    int numThreads = pool->numThreads;
+
+    TransposeThreadData<T>* transData = new TransposeThreadData<T>[numThreads];
+
+    resetDistribution(dist);
+
+    for (int t = 0; t < numThreads; t++) 
+    {
+        transData[t].thread_id = t;
+        transData[t].numThreads = numThreads;
+        transData[t].input = input;
+        transData[t].output = output;
+        transData[t].op = op;
+        transData[t].firstTileCol = firstTileCol;
+        transData[t].numTileCols = numTileCols;
+        transData[t].dist = dist;
+    }
+
+    poolRun(pool, transposeThread<T>, transData, sizeof(TransposeThreadData<T>), numThreads);
+
+    delete[] transData;
+}
+
+// Out-of-place transpose output = op(input)ᵀ on the pool: a rows×cols input
+// (sub)matrix into a cols×rows output (sub)matrix.
+template <typename T>
+void parallelTranspose(WorkerPool* pool, typename ReadView<T>::Type input, MatrixView<T> output, ElementwiseOp op, Distribution* dist)
+{
+    if (output.rows != input.cols || output.cols != input.rows) 
+    {
+        cerr << "Error: transposing a " << input.rows << "x" << input.cols << " matrix into a " 
+             << output.rows << "x" << output.cols << " one" << endl;
+
+        exit(-1);
+    }
+
+    parallelTransposeBand(pool, input, output, 0, (input.cols + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE, op, dist);
+}
+
+// Out-of-place transpose output = op(input)ᵀ of an n×n matrix on the pool.
+template <typename T>
+void parallelTranspose(WorkerPool* pool, const T* input, T* output, int n, ElementwiseOp op, Distribution* dist)
+{
+    parallelTranspose(pool, squareView(input, n), squareView(output, n), op, dist);
+}
+
+// Swaps two K×K blocks (K = TransposeKernel<T>::EDGE) of the same matrix
+// across the diagonal: a becomes bᵀ and b becomes aᵀ. With a == b the block
+// is transposed in place. Block a is staged in a small (L1-resident) buffer.
+template <typename T>
+inline void transposeSwapKernel(T* a, T* b, long ld)
+{
+    const int K = TransposeKernel<T>::EDGE;
+
+    T staged[K * K];
+
+    for (int r = 0; r < K; r++)
+        memcpy(&staged[r * K], a + r * ld, K * sizeof(T));
+
+    if (a != b)
+        transposeKernel(b, ld, a, ld, IdentityOp());
+
+    transposeKernel(staged, K, b, ld, IdentityOp());
+}
+
+// Transposes the tile pair (tileRow, tileCol) / (tileCol, tileRow) in place,
+// with tileRow <= tileCol. A diagonal tile (tileRow == tileCol) is transposed
+// locally: only its blocks on or above the diagonal are visited.
+template <typename T>
+void transposeTilePairInPlace(MatrixView<T> matrix, int tileRow, int tileCol)
+{
+    const int K = TransposeKernel<T>::EDGE;
+
+    int n = matrix.rows;
+
+    bool diagonal = (tileRow == tileCol);
+
+    int rowStart = tileRow * TRANSPOSE_TILE, colStart = tileCol * TRANSPOSE_TILE;
+    int rowEnd = (rowStart + TRANSPOSE_TILE < n) ? rowStart + TRANSPOSE_TILE : n;
+    int colEnd = (colStart + TRANSPOSE_TILE < n) ? colStart + TRANSPOSE_TILE : n;
+
+    int i = rowStart;
+
+    for (; i + K <= rowEnd; i += K)
+    {
+        int j = diagonal ? i : colStart;
+
+        for (; j + K <= colEnd; j += K)
+            transposeSwapKernel(&matrix(i, j), &matrix(j, i), matrix.ld);
+
+        // Ragged right edge (always strictly above the diagonal).
+        for (; j < colEnd; j++)
+        {
+            for (int r = i; r < i + K; r++)
+                swap(matrix(r, j), matrix(j, r));
+        }
+    }
+
+    // Ragged bottom edge: on a diagonal tile only the elements above the
+    // diagonal are swapped, their mirrors were handled by the loop above.
+    for (; i < rowEnd; i++)
+    {
+        for (int j = colStart; j < colEnd; j++)
+        {
+            if (!diagonal || j > i)
+                swap(matrix(i, j), matrix(j, i));
+        }
+    }
+}
+
+// Thread function for in-place transposition of a square matrix.
+// The tile pairs (tileRow <= tileCol) are numbered row by row along the upper
+// triangle of the tile grid and dealt to the threads in ranges.
+template <typename T>
+void* transposeInPlaceThread(void* arg) 
+{
+    InPlaceTransposeThreadData<T>* data = (InPlaceTransposeThreadData<T>*) arg;
+
+    MatrixView<T> matrix = data->matrix;
+
+    int n = matrix.rows;
+    int tilesPerRow = (n + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+    long numPairs = (long) tilesPerRow * (tilesPerRow + 1) / 2;
+
+    long step = 0, firstPair, lastPair;
+
+    while (nextRange(data->dist, data->thread_id, data->numThreads, numPairs, &step, &firstPair, &lastPair)) 
+    {
+        // Locating the first pair: upper-triangle row tileRow holds (tilesPerRow - tileRow) pairs.
+        int tileRow = 0;
+        long rowFirstPair = 0;
+
+        while (tileRow < tilesPerRow && rowFirstPair + (tilesPerRow - tileRow) <= firstPair)
+        {
+            rowFirstPair += tilesPerRow - tileRow;
+            tileRow++;
+        }
+
+        int tileCol = tileRow + (int) (firstPair - rowFirstPair);
+
+        for (long pair = firstPair; pair < lastPair; pair++)
+        {
+            transposeTilePairInPlace(matrix, tileRow, tileCol);
+
+            if (++tileCol == tilesPerRow)
+            {
+                tileRow++;
+                tileCol = tileRow;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// Transposes a square (sub)matrix onto itself on the pool.
+template <typename T>
+void parallelTransposeInPlace(WorkerPool* pool, MatrixView<T> matrix, Distribution* dist)
+{
+    if (matrix.rows != matrix.cols) 
+    {
+        cerr << "Error: in-place transpose of a non-square " << matrix.rows << "x" << matrix.cols << " matrix" << endl;
+
+        exit(-1);
+    }
+
+    int numThreads = pool->numThreads;
+
+    InPlaceTransposeThreadData<T>* inPlaceData = new InPlaceTransposeThreadData<T>[numThreads];
+
+    resetDistribution(dist);
+
+    for (int t = 0; t < numThreads; t++) 
+    {
+        inPlaceData[t].thread_id = t;
+        inPlaceData[t].numThreads = numThreads;
+        inPlaceData[t].matrix = matrix;
+        inPlaceData[t].dist = dist;
+    }
+
+    poolRun(pool, transposeInPlaceThread<T>, inPlaceData, sizeof(InPlaceTransposeThreadData<T>), numThreads);
+
+    delete[] inPlaceData;
+}
+
+// Transposes an n×n matrix onto itself on the pool.
+template <typename T>
+void parallelTransposeInPlace(WorkerPool* pool, T* matrix, int n, Distribution* dist)
+{
+    parallelTransposeInPlace(pool, squareView(matrix, n), dist);
+}
+
+// Thread function for element-wise logarithm transformation.
+template <typename T>
+void* logThread(void* arg) 
+{
+    LogThreadData<T>* data = (LogThreadData<T>*) arg;
+
+    const T* input = data->input;
+    T* output = data->output;
+    LogAccuracy accuracy = data->accuracy;
+
+    if (data->rows > 0) 
+    {
+        long step = 0, first, last;
+
+        while (nextRange(data->dist, data->thread_id, data->numThreads, data->rows, &step, &first, &last)) 
+        {
+            for (long r = first; r < last; r++) 
+            {
+                if (accuracy == LOG_EXACT)
+                    logRange<LOG_EXACT>(&input[r * data->inputLd], &output[r * data->outputLd], data->count);
+                else
+                    logRange<LOG_FAST>(&input[r * data->inputLd], &output[r * data->outputLd], data->count);
+            }
+        }
+
+        return NULL;
+    }
+
+    forEachLineRange<T>(data->dist, data->thread_id, data->numThreads, data->count, [&](long start, long end) {
+        if (accuracy == LOG_EXACT)
+            logRange<LOG_EXACT>(&input[start], &output[start], end - start);
+        else
+            logRange<LOG_FAST>(&input[start], &output[start], end - start);
+    });
+
+    return NULL;
+}
+
+// Runs logThread on the pool: count contiguous elements (rows 0), or rows
+// rows of count elements with the given leading dimensions.
+template <typename T>
+void runLog(WorkerPool* pool, const T* input, T* output, long count, int rows, long inputLd, long outputLd, 
+            LogAccuracy accuracy, Distribution* dist)
+{
+    int numThreads = pool->numThreads;
+
+    LogThreadData<T>* logData = new LogThreadData<T>[numThreads];
+
+    resetDistribution(dist);
+
+    for (int t = 0; t < numThreads; t++) 
+    {
+        logData[t].thread_id = t;
+        logData[t].numThreads = numThreads;
+        logData[t].count = count;
+        logData[t].input = input;
+        logData[t].output = output;
+        logData[t].rows = rows;
+        logData[t].inputLd = inputLd;
+        logData[t].outputLd = outputLd;
+        logData[t].accuracy = accuracy;
+        logData[t].dist = dist;
+    }
+
+    poolRun(pool, logThread<T>, logData, sizeof(LogThreadData<T>), numThreads);
+
+    delete[] logData;
+}
+
+// Element-wise output = log(input) of count elements on the pool.
+template <typename T>
+void parallelLogRange(WorkerPool* pool, const T* input, T* output, long count, LogAccuracy accuracy, Distribution* dist)
+{
+    runLog(pool, input, output, count, 0, 0, 0, accuracy, dist);
+}
+
+// Element-wise output = log(input) of two (sub)matrices of the same shape on
+// the pool. Views without gaps between the rows are processed as one range.
+template <typename T>
+void parallelLog(WorkerPool* pool, typename ReadView<T>::Type input, MatrixView<T> output, LogAccuracy accuracy, Distribution* dist)
+{
+    if (output.rows != input.rows || output.cols != input.cols) 
+    {
+        cerr << "Error: log of a " << input.rows << "x" << input.cols << " matrix into a " 
+             << output.rows << "x" << output.cols << " one" << endl;
+
+        exit(-1);
+    }
+
+    if (input.ld == input.cols && output.ld == output.cols)
+        runLog(pool, input.data, output.data, (long) input.rows * input.cols, 0, 0, 0, accuracy, dist);
+    else
+        runLog(pool, input.data, output.data, input.cols, input.rows, input.ld, output.ld, accuracy, dist);
+}
+
+// Element-wise output = log(input) of an n×n matrix on the pool.
+template <typename T>
+void parallelLog(WorkerPool* pool, const T* input, T* output, int n, LogAccuracy accuracy, Distribution* dist)
+{
+    parallelLogRange(pool, input, output, (long) n * n, accuracy, dist);
+}
+
+// -----------------------------
+// Element-wise Expressions
+// -----------------------------
+// Chains such as clamp(log(0.5 * A + 1), lo, hi) are built lazily: the
+// operators below only assemble a tree of small nodes whose type encodes the
+// whole chain, and parallelEvaluate makes a single pass over the matrix,
+// computing every output vector through the full chain while it is still in
+// registers. Each intermediate matrix that is never stored saves one write
+// and one read of n×n elements. Work is dealt in cache lines, as for the log.
+//
+// Nodes are held by value (a leaf is just a pointer or a constant), so an
+// expression can outlive the temporaries it was built from. Every node has
+// eval<V>(i), returning element i when V is the element type or the vector
+// starting at i when V is a SimdVec.
+
+template <typename E>
+struct Expr 
+{
+    const E& self() const { return static_cast<const E&>(*this); }
+};
+
+// Leaf loads, picked by the requested result type.
+template <typename T> inline SimdVec<T> loadAs(const T* p, SimdVec<T>*) { return simdLoad(p); }
+template <typename T> inline T loadAs(const T* p, T*) { return *p; }
+
+// A matrix (or any contiguous buffer) read element-wise.
+template <typename T>
+struct MatrixExpr : Expr<MatrixExpr<T> > 
+{
+    typedef T ValueType;
+    const T* data;
+
+    explicit MatrixExpr(const T* d) : data(d) {}
+
+    template <typename V> V eval(long i) const { return loadAs(data + i, (V*) NULL); }
+};
+
+// A scalar broadcast to every element.
+template <typename T>
+struct ConstantExpr : Expr<ConstantExpr<T> > 
+{
+    typedef T ValueType;
+    T value;
+
+    explicit ConstantExpr(T v) : value(v) {}
+
+    template <typename V> V eval(long) const { return V(value); }
+};
+
+template <typename Op, typename L, typename R>
+struct BinaryExpr : Expr<BinaryExpr<Op, L, R> > 
+{
+    typedef typename L::ValueType ValueType;
+    L left;
+    R right;
+
+    BinaryExpr(const L& l, const R& r) : left(l), right(r) {}
+
+    template <typename V> V eval(long i) const { return Op()(left.template eval<V>(i), right.template eval<V>(i)); }
+};
+
+template <typename Op, typename E>
+struct UnaryExpr : Expr<UnaryExpr<Op, E> > 
+{
+    typedef typename E::ValueType ValueType;
+    E operand;
+
+    explicit UnaryExpr(const E& e) : operand(e) {}
+
+    template <typename V> V eval(long i) const { return Op()(operand.template eval<V>(i)); }
+};
+
+// Node operations, callable on a whole vector or on a single element (the
+// logarithm reuses LogOp from the transpose fusion).
+struct AddOp { template <typename V> V operator()(V a, V b) const { return a + b; } };
+struct SubOp { template <typename V> V operator()(V a, V b) const { return a - b; } };
+struct MulOp { template <typename V> V operator()(V a, V b) const { return a * b; } };
+struct DivOp { template <typename V> V operator()(V a, V b) const { return a / b; } };
+struct MinOp { template <typename V> V operator()(V a, V b) const { return simdMin(a, b); } };
+struct MaxOp { template <typename V> V operator()(V a, V b) const { return simdMax(a, b); } };
+struct SqrtOp { template <typename V> V operator()(V x) const { return simdSqrt(x); } };
+struct AbsOp { template <typename V> V operator()(V x) const { return simdAbs(x); } };
+
+// Wraps a buffer as the leaf of an expression.
+template <typename T>
+inline MatrixExpr<T> lazyMatrix(const T* data) 
+{
+    return MatrixExpr<T>(data);
+}
+
+// Arithmetic between two expressions, or an expression and a scalar of its
+// element type (the scalar becomes a ConstantExpr).
+#define EXPR_BINARY_OPERATOR(SYMBOL, OP)                                                        \
+    template <typename L, typename R>                                                           \
+    inline BinaryExpr<OP, L, R> operator SYMBOL(const Expr<L>& l, const Expr<R>& r)             \
+    {                                                                                           \
+        return BinaryExpr<OP, L, R>(l.self(), r.self());                                        \
+    }                                                                                           \
+    template <typename L>                                                                       \
+    inline BinaryExpr<OP, L, ConstantExpr<typename L::ValueType> >                              \
+    operator SYMBOL(const Expr<L>& l, typename L::ValueType r)                                  \
+    {                                                                                           \
+        return BinaryExpr<OP, L, ConstantExpr<typename L::ValueType> >(l.self(),                \
+                   ConstantExpr<typename L::ValueType>(r));                                     \
+    }                                                                                           \
+    template <typename R>                                                                       \
+    inline BinaryExpr<OP, ConstantExpr<typename R::ValueType>, R>                               \
+    operator SYMBOL(typename R::ValueType l, const Expr<R>& r)                                  \
+    {                                                                                           \
+        return BinaryExpr<OP, ConstantExpr<typename R::ValueType>, R>(                          \
+                   ConstantExpr<typename R::ValueType>(l), r.self());                           \
+    }
+
+EXPR_BINARY_OPERATOR(+, AddOp)
+EXPR_BINARY_OPERATOR(-, SubOp)
+EXPR_BINARY_OPERATOR(*, MulOp)
+EXPR_BINARY_OPERATOR(/, DivOp)
+
+#undef EXPR_BINARY_OPERATOR
+
+template <typename E>
+inline UnaryExpr<LogOp<LOG_EXACT>, E> lazyLog(const Expr<E>& e) 
+{
+    return UnaryExpr<LogOp<LOG_EXACT>, E>(e.self());
+}
+
+template <typename E>
+inline UnaryExpr<LogOp<LOG_FAST>, E> lazyLogFast(const Expr<E>& e) 
+{
+    return UnaryExpr<LogOp<LOG_FAST>, E>(e.self());
+}
+
+template <typename E>
+inline UnaryExpr<SqrtOp, E> lazySqrt(const Expr<E>& e) 
+{
+    return UnaryExpr<SqrtOp, E>(e.self());
+}
+
+template <typename E>
+inline UnaryExpr<AbsOp, E> lazyAbs(const Expr<E>& e) 
+{
+    return UnaryExpr<AbsOp, E>(e.self());
+}
+
+template <typename L, typename R>
+inline BinaryExpr<MinOp, L, R> lazyMin(const Expr<L>& l, const Expr<R>& r) 
+{
+    return BinaryExpr<MinOp, L, R>(l.self(), r.self());
+}
+
+template <typename L, typename R>
+inline BinaryExpr<MaxOp, L, R> lazyMax(const Expr<L>& l, const Expr<R>& r) 
+{
+    return BinaryExpr<MaxOp, L, R>(l.self(), r.self());
+}
+
+// Clamps every element to [lo, hi]; NaN elements come out as lo.
+template <typename E>
+inline BinaryExpr<MaxOp, BinaryExpr<MinOp, E, ConstantExpr<typename E::ValueType> >, ConstantExpr<typename E::ValueType> >
+lazyClamp(const Expr<E>& e, typename E::ValueType lo, typename E::ValueType hi) 
+{
+    typedef ConstantExpr<typename E::ValueType> Constant;
+
+    return lazyMax(lazyMin(e, Constant(hi)), Constant(lo));
+}
+
+// Evaluates the expression at output[start, end): whole vectors, then a
+// scalar tail.
+template <typename T, typename E>
+inline void evaluateRange(const E& expr, T* output, long start, long end)
+{
+    const int W = SimdVec<T>::WIDTH;
+
+    long i = start;
+
+    for (; i + W <= end; i += W)
+        simdStore(&output[i], expr.template eval<SimdVec<T> >(i));
+
+    for (; i < end; i++)
+        output[i] = expr.template eval<T>(i);
+}
+
+// Thread function for lazy expression evaluation.
+template <typename T, typename E>
+void* exprThread(void* arg) 
+{
+    ExprThreadData<T, E>* data = (ExprThreadData<T, E>*) arg;
+
+    const E* expr = data->expr;
+    T* output = data->output;
+
+    forEachLineRange<T>(data->dist, data->thread_id, data->numThreads, data->count, [&](long start, long end) {
+        evaluateRange(*expr, output, start, end);
+    });
+
+    return NULL;
+}
+
+// output[i] = expr at i for count elements, in one pass on the pool. The
+// output may be one of the expression's own leaves (in-place update).
+template <typename T, typename E>
+void parallelEvaluate(WorkerPool* pool, T* output, long count, const Expr<E>& expr, Distribution* dist)
+{
+    int numThreads = pool->numThreads;
+
+    ExprThreadData<T, E>* exprData = new ExprThreadData<T, E>[numThreads];
+
+    resetDistribution(dist);
+
+    for (int t = 0; t < numThreads; t++) 
+    {
+        exprData[t].thread_id = t;
+        exprData[t].numThreads = numThreads;
+        exprData[t].count = count;
+        exprData[t].expr = &expr.self();
+        exprData[t].output = output;
+        exprData[t].dist = dist;
+    }
+
+    poolRun(pool, exprThread<T, E>, exprData, sizeof(ExprThreadData<T, E>), numThreads);
+
+    delete[] exprData;
+}
+
+// The chain of the expression stage and benchmark: sqrt(clamp(log(0.5 · A + 1), 1, 6)).
+template <typename T>
+void parallelExprChain(WorkerPool* pool, const T* input, T* output, long count, Distribution* dist)
+{
+    MatrixExpr<T> a = lazyMatrix(input);
+
+    parallelEvaluate(pool, output, count, lazySqrt(lazyClamp(lazyLog(T(0.5) * a + T(1)), T(1), T(6))), dist);
+}
+
+// The same chain one node per pass, each intermediate stored to output (and
+// read back by the next pass): what the chain costs without fusion.
+template <typename T>
+void parallelExprChainUnfused(WorkerPool* pool, const T* input, T* output, long count, Distribution* dist)
+{
+    MatrixExpr<T> a = lazyMatrix(input), out = lazyMatrix((const T*) output);
+
+    parallelEvaluate(pool, output, count, T(0.5) * a + T(1), dist);
+    parallelEvaluate(pool, output, count, lazyLog(out), dist);
+    parallelEvaluate(pool, output, count, lazyClamp(out, T(1), T(6)), dist);
+    parallelEvaluate(pool, output, count, lazySqrt(out), dist);
+}
+
+// -----------------------------
+// Random Matrix Initialization
+// -----------------------------
+// Element i of a random matrix is a function of (seed, i) only: a counter
+// based generator hashes the element index with the SplitMix64 finalizer
+// under a key derived from the seed, so any thread can produce any element
+// without shared state, and the matrix is bit-identical for a given seed
+// whatever the thread count or distribution policy. Normal values take two
+// draws per element (Box-Muller on counters 2i and 2i + 1).
+
+// SplitMix64 finalizer: a bijective mix of the 64 bits.
+inline uint64_t mix64(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+    return z ^ (z >> 31);
+}
+
+inline uint64_t randomKey(uint64_t seed)
+{
+    return mix64(seed);
+}
+
+// 64 random bits of the given counter.
+inline uint64_t randomBits(uint64_t key, uint64_t counter)
+{
+    return mix64(key + (counter + 1) * 0x9E3779B97F4A7C15ULL);
+}
+
+// Uniform in [0, 1) from the top 53 bits.
+inline double unitInterval(uint64_t bits)
+{
+    return (bits >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Value of element i of the random sequence.
+inline double randomValue(uint64_t key, long i, RandomFill fill)
+{
+    if (fill == FILL_POSITIVE)
+        return 1.0 + (double) (((randomBits(key, i) >> 32) * 1000) >> 32);
+
+    if (fill == FILL_UNIFORM)
+        return unitInterval(randomBits(key, i));
+
+    // u1 in (0, 1], so the logarithm is finite.
+    double u1 = 1.0 - unitInterval(randomBits(key, 2 * (uint64_t) i));
+    double u2 = unitInterval(randomBits(key, 2 * (uint64_t) i + 1));
+
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+// Thread function for random matrix initialization.
+template <typename T>
+void* randomFillThread(void* arg) 
+{
+    RandomThreadData<T>* data = (RandomThreadData<T>*) arg;
+
+    T* output = data->output;
+    long first = data->first;
+    RandomFill fill = data->fill;
+    uint64_t key = data->key;
+
+    forEachLineRange<T>(data->dist, data->thread_id, data->numThreads, data->count, [&](long start, long end) {
+        for (long i = start; i < end; i++)
+            output[i] = (T) randomValue(key, first + i, fill);
+    });
+
+    return NULL;
+}
+
+// output[k] = element first + k of the random sequence of seed, for count
+// elements on the pool.
+template <typename T>
+void parallelRandomFillRange(WorkerPool* pool, T* output, long first, long count, RandomFill fill, uint64_t seed, Distribution* dist)
+{
+    int numThreads = pool->numThreads;
+
+    RandomThreadData<T>* randomData = new RandomThreadData<T>[numThreads];
+
+    resetDistribution(dist);
+
+    for (int t = 0; t < numThreads; t++) 
+    {
+        randomData[t].thread_id = t;
+        randomData[t].numThreads = numThreads;
+        randomData[t].first = first;
+        randomData[t].count = count;
+        randomData[t].output = output;
+        randomData[t].fill = fill;
+        randomData[t].key = randomKey(seed);
+        randomData[t].dist = dist;
+    }
+
+    poolRun(pool, randomFillThread<T>, randomData, sizeof(RandomThreadData<T>), numThreads);
+
+    delete[] randomData;
+}
+
+// Fills an n×n matrix with the random sequence of seed on the pool.
+template <typename T>
+void parallelRandomFill(WorkerPool* pool, T* matrix, int n, RandomFill fill, uint64_t seed, Distribution* dist)
+{
+    parallelRandomFillRange(pool, matrix, 0, (long) n * n, fill, seed, dist);
+}
+
+inline bool parseRandomFill(const char* name, RandomFill* fill)
+{
+    if (strcmp(name, "positive") == 0)
+        *fill = FILL_POSITIVE;
+    else if (strcmp(name, "uniform") == 0)
+        *fill = FILL_UNIFORM;
+    else if (strcmp(name, "normal") == 0)
+        *fill = FILL_NORMAL;
+    else
+        return false;
+
+    return true;
+}
+
+// -----------------------------
+// Reductions
+// -----------------------------
+// Sums, sums of squares (Frobenius norm), minima, maxima and the trace of a
+// matrix, whole or per row / per column. The results do not depend on the
+// thread count or the distribution: the work is cut into fixed units (rows,
+// or blocks of REDUCE_BLOCK_ROWS rows for the column reductions), one thread
+// reduces each unit with Kahan-compensated SIMD accumulators folded in a
+// fixed order, and the unit results are combined by pairwise summation in
+// unit order. Minima and maxima are exact in any order: the whole-matrix
+// reduction folds them into padded per-thread partials as it goes.
+
+// Adds x to the compensated sum (sum, compensation); lane-wise on vectors.
+template <typename V>
+inline void kahanAdd(V* sum, V* compensation, V x)
+{
+    V y = x - *compensation;
+    V t = *sum + y;
+
+    *compensation = (t - *sum) - y;
+    *sum = t;
+}
+
+// Adds the lanes of a vector sum and its compensation, lane 0 first.
+template <typename T>
+inline void kahanAddLanes(T* sum, T* compensation, SimdVec<T> laneSums, SimdVec<T> laneCompensations)
+{
+    T lanes[SimdVec<T>::WIDTH], corrections[SimdVec<T>::WIDTH];
+
+    simdStore(lanes, laneSums);
+    simdStore(corrections, laneCompensations);
+
+    for (int lane = 0; lane < SimdVec<T>::WIDTH; lane++) 
+    {
+        kahanAdd(sum, compensation, lanes[lane]);
+        kahanAdd(sum, compensation, -corrections[lane]);
+    }
+}
+
+template <typename T>
+inline T minLanes(SimdVec<T> v)
+{
+    T lanes[SimdVec<T>::WIDTH];
+
+    simdStore(lanes, v);
+
+    T result = lanes[0];
+
+    for (int lane = 1; lane < SimdVec<T>::WIDTH; lane++)
+        result = simdMin(result, lanes[lane]);
+
+    return result;
+}
+
+template <typename T>
+inline T maxLanes(SimdVec<T> v)
+{
+    T lanes[SimdVec<T>::WIDTH];
+
+    simdStore(lanes, v);
+
+    T result = lanes[0];
+
+    for (int lane = 1; lane < SimdVec<T>::WIDTH; lane++)
+        result = simdMax(result, lanes[lane]);
+
+    return result;
+}
+
+// Reduction of one row.
+template <typename T>
+struct RowReduction 
+{
+    double sum, squares;
+    T min, max;
+};
+
+// Reduces count >= 1 contiguous elements: REDUCE_UNROLL vectors of
+// independent accumulators (to hide the latency of the compensated adds),
+// folded accumulator by accumulator and lane by lane, then the scalar tail.
+template <typename T>
+RowReduction<T> reduceRow(const T* row, long count)
+{
+    typedef SimdVec<T> V;
+
+    const int W = V::WIDTH;
+    const int U = REDUCE_UNROLL;
+
+    V sum[U], sumCompensation[U], squares[U], squaresCompensation[U], lo[U], hi[U];
+
+    for (int u = 0; u < U; u++) 
+    {
+        sum[u] = sumCompensation[u] = squares[u] = squaresCompensation[u] = V(T(0));
+        lo[u] = hi[u] = V(row[0]);
+    }
+
+    long j = 0;
+
+    for (; j + U * W <= count; j += U * W) 
+    {
+        for (int u = 0; u < U; u++) 
+        {
+            V x = simdLoad(&row[j + u * W]);
+
+            kahanAdd(&sum[u], &sumCompensation[u], x);
+            kahanAdd(&squares[u], &squaresCompensation[u], x * x);
+
+            lo[u] = simdMin(lo[u], x);
+            hi[u] = simdMax(hi[u], x);
+        }
+    }
+
+    for (; j + W <= count; j += W) 
+    {
+        V x = simdLoad(&row[j]);
+
+        kahanAdd(&sum[0], &sumCompensation[0], x);
+        kahanAdd(&squares[0], &squaresCompensation[0], x * x);
+
+        lo[0] = simdMin(lo[0], x);
+        hi[0] = simdMax(hi[0], x);
+    }
+
+    T s = 0, sc = 0, q = 0, qc = 0, mn = row[0], mx = row[0];
+
+    for (int u = 0; u < U; u++) 
+    {
+        kahanAddLanes(&s, &sc, sum[u], sumCompensation[u]);
+        kahanAddLanes(&q, &qc, squares[u], squaresCompensation[u]);
+
+        mn = simdMin(mn, minLanes(lo[u]));
+        mx = simdMax(mx, maxLanes(hi[u]));
+    }
+
+    for (; j < count; j++) 
+    {
+        T x = row[j];
+
+        kahanAdd(&s, &sc, x);
+        kahanAdd(&q, &qc, x * x);
+
+        mn = simdMin(mn, x);
+        mx = simdMax(mx, x);
+    }
+
+    RowReduction<T> result;
+
+    result.sum = (double) s - (double) sc;
+    result.squares = (double) q - (double) qc;
+    result.min = mn;
+    result.max = mx;
+
+    return result;
+}
+
+// Pairwise sum of count values in a fixed order (recursive halving): the
+// rounding error grows with log(count) instead of count.
+inline double pairwiseSum(const double* values, long count)
+{
+    if (count <= 8) 
+    {
+        double sum = 0.0;
+
+        for (long i = 0; i < count; i++)
+            sum += values[i];
+
+        return sum;
+    }
+
+    long half = count / 2;
+
+    return pairwiseSum(values, half) + pairwiseSum(values + half, count - half);
+}
+
+// Thread function for row reductions: every row dealt is reduced on its own
+// and its results stored at its index; with a partial, its min/max are also
+// folded into this thread's running min/max.
+template <typename T>
+void* reduceRowsThread(void* arg) 
+{
+    ReduceThreadData<T>* data = (ReduceThreadData<T>*) arg;
+
+    MatrixView<const T> matrix = data->matrix;
+    long step = 0, first, last;
+
+    while (nextRange(data->dist, data->thread_id, data->numThreads, matrix.rows, &step, &first, &last)) 
+    {
+        for (long i = first; i < last; i++) 
+        {
+            const T* row = &matrix(i, 0);
+
+            RowReduction<T> r = reduceRow(row, matrix.cols);
+
+            if (data->sums != NULL)
+                data->sums[i] = r.sum;
+
+            if (data->squares != NULL)
+                data->squares[i] = r.squares;
+
+            if (data->mins != NULL)
+                data->mins[i] = r.min;
+
+            if (data->maxs != NULL)
+                data->maxs[i] = r.max;
+
+            if (data->diagonal != NULL && i < matrix.cols)
+                data->diagonal[i] = row[i];
+
+            if (data->partial != NULL) 
+            {
+                data->partial->min = simdMin(data->partial->min, r.min);
+                data->partial->max = simdMax(data->partial->max, r.max);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// Thread function for column reductions, first pass: a unit is a block of
+// REDUCE_BLOCK_ROWS rows, reduced down its columns a vector of columns at a
+// time (no folding of lanes) into row b of the blocks × n arrays.
+template <typename T>
+void* reduceColumnBlocksThread(void* arg) 
+{
+    ReduceThreadData<T>* data = (ReduceThreadData<T>*) arg;
+
+    typedef SimdVec<T> V;
+
+    const int W = V::WIDTH;
+
+    MatrixView<const T> matrix = data->matrix;
+    int n = matrix.cols;
+    long step = 0, first, last;
+
+    while (nextRange(data->dist, data->thread_id, data->numThreads, data->blocks, &step, &first, &last)) 
+    {
+        for (long b = first; b < last; b++) 
+        {
+            long r0 = b * REDUCE_BLOCK_ROWS;
+            long r1 = min(r0 + REDUCE_BLOCK_ROWS, (long) matrix.rows);
+            long out = b * n;
+
+            long j = 0;
+
+            for (; j + W <= n; j += W) 
+            {
+                V sum = V(T(0)), sumCompensation = V(T(0)), squares = V(T(0)), squaresCompensation = V(T(0));
+                V lo = simdLoad(&matrix(r0, j)), hi = lo;
+
+                for (long r = r0; r < r1; r++) 
+                {
+                    V x = simdLoad(&matrix(r, j));
+
+                    kahanAdd(&sum, &sumCompensation, x);
+                    kahanAdd(&squares, &squaresCompensation, x * x);
+
+                    lo = simdMin(lo, x);
+                    hi = simdMax(hi, x);
+                }
+
+                T s[W], sc[W], q[W], qc[W];
+
+                simdStore(s, sum);
+                simdStore(sc, sumCompensation);
+                simdStore(q, squares);
+                simdStore(qc, squaresCompensation);
+
+                for (int lane = 0; lane < W; lane++) 
+                {
+                    if (data->sums != NULL)
+                        data->sums[out + j + lane] = (double) s[lane] - (double) sc[lane];
+
+                    if (data->squares != NULL)
+                        data->squares[out + j + lane] = (double) q[lane] - (double) qc[lane];
+                }
+
+                if (data->mins != NULL)
+                    simdStore(&data->mins[out + j], lo);
+
+                if (data->maxs != NULL)
+                    simdStore(&data->maxs[out + j], hi);
+            }
+
+            for (; j < n; j++) 
+            {
+                T s = 0, sc = 0, q = 0, qc = 0, lo = matrix(r0, j), hi = lo;
+
+                for (long r = r0; r < r1; r++) 
+                {
+                    T x = matrix(r, j);
+
+                    kahanAdd(&s, &sc, x);
+                    kahanAdd(&q, &qc, x * x);
+
+                    lo = simdMin(lo, x);
+                    hi = simdMax(hi, x);
+                }
+
+                if (data->sums != NULL)
+                    data->sums[out + j] = (double) s - (double) sc;
+
+                if (data->squares != NULL)
+                    data->squares[out + j] = (double) q - (double) qc;
+
+                if (data->mins != NULL)
+                    data->mins[out + j] = lo;
+
+                if (data->maxs != NULL)
+                    data->maxs[out + j] = hi;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// Thread function for column reductions, second pass: for the columns dealt
+// (in whole cache lines), the block results are combined pairwise in place
+// (block b absorbs block b + width, width = 1, 2, 4, ...); the totals end up
+// in block row 0.
+template <typename T>
+void* combineColumnBlocksThread(void* arg) 
+{
+    ReduceThreadData<T>* data = (ReduceThreadData<T>*) arg;
+
+    int n = data->matrix.cols;
+    long blocks = data->blocks;
+
+    forEachLineRange<double>(data->dist, data->thread_id, data->numThreads, n, [&](long start, long end) {
+        for (long width = 1; width < blocks; width *= 2) 
+        {
+            for (long b = 0; b + width < blocks; b += 2 * width) 
+            {
+                long to = b * n, from = (b + width) * n;
+
+                for (long j = start; j < end; j++) 
+                {
+                    if (data->sums != NULL)
+                        data->sums[to + j] += data->sums[from + j];
+
+                    if (data->squares != NULL)
+                        data->squares[to + j] += data->squares[from + j];
+
+                    if (data->mins != NULL)
+                        data->mins[to + j] = simdMin(data->mins[to + j], data->mins[from + j]);
+
+                    if (data->maxs != NULL)
+                        data->maxs[to + j] = simdMax(data->maxs[to + j], data->maxs[from + j]);
+                }
+            }
+        }
+    });
+
+    return NULL;
+}
+
+template <typename T>
+void allocateLineReductions(LineReductions<T>* lines, int n)
+{
+    lines->sums = new double[n];
+    lines->squares = new double[n];
+    lines->mins = new T[n];
+    lines->maxs = new T[n];
+}
+
+template <typename T>
+void releaseLineReductions(LineReductions<T>* lines)
+{
+    delete[] lines->sums;
+    delete[] lines->squares;
+    delete[] lines->mins;
+    delete[] lines->maxs;
+}
+
+// Runs one of the reduction thread functions on the pool.
+template <typename T>
+void runReduction(WorkerPool* pool, void* (*task)(void*), MatrixView<const T> matrix, int blocks,
+                  double* sums, double* squares, T* mins, T* maxs, double* diagonal,
+                  ReducePartial<T>* partials, Distribution* dist)
+{
+    int numThreads = pool->numThreads;
+
+    ReduceThreadData<T>* reduceData = new ReduceThreadData<T>[numThreads];
+
+    resetDistribution(dist);
+
+    for (int t = 0; t < numThreads; t++) 
+    {
+        reduceData[t].thread_id = t;
+        reduceData[t].numThreads = numThreads;
+        reduceData[t].matrix = matrix;
+        reduceData[t].blocks = blocks;
+        reduceData[t].sums = sums;
+        reduceData[t].squares = squares;
+        reduceData[t].mins = mins;
+        reduceData[t].maxs = maxs;
+        reduceData[t].diagonal = diagonal;
+        reduceData[t].partial = (partials != NULL) ? &partials[t] : NULL;
+        reduceData[t].dist = dist;
+    }
+
+    poolRun(pool, task, reduceData, sizeof(ReduceThreadData<T>), numThreads);
+
+    delete[] reduceData;
+}
+
+// Per-row sums, sums of squares, minima and maxima of a (sub)matrix.
+template <typename T>
+void parallelRowReduce(WorkerPool* pool, typename ReadView<T>::Type matrix, LineReductions<T>* rows, Distribution* dist)
+{
+    runReduction(pool, reduceRowsThread<T>, matrix, 0, rows->sums, rows->squares, rows->mins, rows->maxs,
+                 (double*) NULL, (ReducePartial<T>*) NULL, dist);
+}
+
+template <typename T>
+void parallelRowReduce(WorkerPool* pool, const T* matrix, int n, LineReductions<T>* rows, Distribution* dist)
+{
+    parallelRowReduce<T>(pool, squareView(matrix, n), rows, dist);
+}
+
+// Per-column sums, sums of squares, minima and maxima of a (sub)matrix, in
+// two passes over blocks of REDUCE_BLOCK_ROWS rows (see the thread functions).
+template <typename T>
+void parallelColumnReduce(WorkerPool* pool, typename ReadView<T>::Type matrix, LineReductions<T>* columns, Distribution* dist)
+{
+    int n = matrix.cols;
+    int blocks = (matrix.rows + REDUCE_BLOCK_ROWS - 1) / REDUCE_BLOCK_ROWS;
+    long size = (long) blocks * n;
+
+    double* sums = (columns->sums != NULL) ? new double[size] : NULL;
+    double* squares = (columns->squares != NULL) ? new double[size] : NULL;
+    T* mins = (columns->mins != NULL) ? new T[size] : NULL;
+    T* maxs = (columns->maxs != NULL) ? new T[size] : NULL;
+
+    runReduction(pool, reduceColumnBlocksThread<T>, matrix, blocks, sums, squares, mins, maxs,
+                 (double*) NULL, (ReducePartial<T>*) NULL, dist);
+
+    runReduction(pool, combineColumnBlocksThread<T>, matrix, blocks, sums, squares, mins, maxs,
+                 (double*) NULL, (ReducePartial<T>*) NULL, dist);
+
+    if (sums != NULL)
+        memcpy(columns->sums, sums, n * sizeof(double));
+
+    if (squares != NULL)
+        memcpy(columns->squares, squares, n * sizeof(double));
+
+    if (mins != NULL)
+        memcpy(columns->mins, mins, n * sizeof(T));
+
+    if (maxs != NULL)
+        memcpy(columns->maxs, maxs, n * sizeof(T));
+
+    delete[] sums;
+    delete[] squares;
+    delete[] mins;
+    delete[] maxs;
+}
+
+template <typename T>
+void parallelColumnReduce(WorkerPool* pool, const T* matrix, int n, LineReductions<T>* columns, Distribution* dist)
+{
+    parallelColumnReduce<T>(pool, squareView(matrix, n), columns, dist);
+}
+
+// Sum, Frobenius norm, trace, minimum and maximum of a (sub)matrix in one
+// pass: per-row sums, sums of squares and diagonal elements, combined
+// pairwise; min/max from the threads' padded partials. The trace of a
+// rectangular matrix is that of its leading square.
+template <typename T>
+MatrixReduction<T> parallelReduce(WorkerPool* pool, typename ReadView<T>::Type matrix, Distribution* dist)
+{
+    int numThreads = pool->numThreads;
+    int n = matrix.rows;
+    int diagonalLength = min(matrix.rows, matrix.cols);
+
+    double* rowSums = new double[n];
+    double* rowSquares = new double[n];
+    double* diagonal = new double[diagonalLength];
+
+    // Cache-line aligned, so that each padded partial is a line of its own.
+    ReducePartial<T>* partials;
+
+    // Failure is reported like that of the new[] above.
+    if (posix_memalign((void**) &partials, 64, numThreads * sizeof(ReducePartial<T>)) != 0) 
+    {
+        delete[] rowSums;
+        delete[] rowSquares;
+        delete[] diagonal;
+
+        throw bad_alloc();
+    }
+
+    for (int t = 0; t < numThreads; t++)
+        partials[t].min = partials[t].max = matrix(0, 0);
+
+    runReduction(pool, reduceRowsThread<T>, matrix, 0, rowSums, rowSquares, (T*) NULL, (T*) NULL,
+                 diagonal, partials, dist);
+
+    MatrixReduction<T> result;
+
+    result.sum = pairwiseSum(rowSums, n);
+    result.frobenius = sqrt(pairwiseSum(rowSquares, n));
+    result.trace = pairwiseSum(diagonal, diagonalLength);
+    result.min = partials[0].min;
+    result.max = partials[0].max;
+
+    for (int t = 1; t < numThreads; t++) 
+    {
+        result.min = simdMin(result.min, partials[t].min);
+        result.max = simdMax(result.max, partials[t].max);
+    }
+
+    free(partials);
+    delete[] rowSums;
+    delete[] rowSquares;
+    delete[] diagonal;
+
+    return result;
+}
+
+template <typename T>
+MatrixReduction<T> parallelReduce(WorkerPool* pool, const T* matrix, int n, Distribution* dist)
+{
+    return parallelReduce<T>(pool, squareView(matrix, n), dist);
+}
+
+// -----------------------------
+// Sparse Matrices (CSR / CSC)
+// -----------------------------
+// Mostly-zero matrices are kept compressed (SparseMatrix): conversion from
+// and to dense, a transpose between CSR and CSC, and element-wise transforms
+// that only touch the stored entries (the values array is contiguous, so the
+// dense element-wise kernels and expressions run on it unchanged).
+//
+// The transpose is a counting sort of the entries by inner index: every
+// thread counts the entries of its block of outer lines per inner index (a
+// private histogram), the histograms are turned into per-thread write
+// positions by a prefix sum over threads and lines, and every thread
+// scatters its entries. The blocks are contiguous and balanced by entries,
+// and they are ordered by thread, so indices stay ascending in the output.
+
+template <typename T>
+inline int outerLines(const SparseMatrix<T>* m) 
+{
+    return (m->layout == SPARSE_CSR) ? m->rows : m->cols;
+}
+
+template <typename T>
+inline int innerLines(const SparseMatrix<T>* m) 
+{
+    return (m->layout == SPARSE_CSR) ? m->cols : m->rows;
+}
+
+// Allocates the arrays for nnz entries (offsets are left to the caller).
+template <typename T>
+void allocateSparse(SparseMatrix<T>* m, SparseLayout layout, int rows, int cols, long nnz)
+{
+    m->layout = layout;
+    m->rows = rows;
+    m->cols = cols;
+    m->nnz = nnz;
+    m->offsets = new long[outerLines(m) + 1];
+    m->indices = new int[nnz];
+    m->values = new T[nnz];
+}
+
+template <typename T>
+void releaseSparse(SparseMatrix<T>* m)
+{
+    delete[] m->offsets;
+    delete[] m->indices;
+    delete[] m->values;
+}
+
+// The transposed matrix without copying: the CSC of A read as the CSR of Aᵀ
+// (and vice versa). Shares the arrays of m.
+template <typename T>
+SparseMatrix<T> sparseTransposeView(const SparseMatrix<T>* m)
+{
+    SparseMatrix<T> view = *m;
+
+    view.layout = (m->layout == SPARSE_CSR) ? SPARSE_CSC : SPARSE_CSR;
+    view.rows = m->cols;
+    view.cols = m->rows;
+
+    return view;
+}
+
+// Bytes held by the compressed arrays.
+template <typename T>
+double sparseBytes(const SparseMatrix<T>* m)
+{
+    return (double) (outerLines(m) + 1) * sizeof(long) + (double) m->nnz * (sizeof(int) + sizeof(T));
+}
+
+// Thread function for dense → CSR, first pass: the non-zeros of every row
+// dealt, left in offsets[row + 1].
+template <typename T>
+void* sparseCountRowsThread(void* arg) 
+{
+    SparseThreadData<T>* data = (SparseThreadData<T>*) arg;
+
+    SparseMatrix<T>* out = data->out;
+    long cols = out->cols;
+    long step = 0, first, last;
+
+    while (nextRange(data->dist, data->thread_id, data->numThreads, out->rows, &step, &first, &last)) 
+    {
+        for (long r = first; r < last; r++) 
+        {
+            const T* row = &data->dense[r * cols];
+
+            long count = 0;
+
+            for (long c = 0; c < cols; c++)
+                count += (row[c] != T(0));
+
+            out->offsets[r + 1] = count;
+        }
+    }
+
+    return NULL;
+}
+
+// Thread function for dense → CSR, second pass: the entries of every row
+// dealt, written from the row's (prefix-summed) offset.
+template <typename T>
+void* sparseFillRowsThread(void* arg) 
+{
+    SparseThreadData<T>* data = (SparseThreadData<T>*) arg;
+
+    SparseMatrix<T>* out = data->out;
+    long cols = out->cols;
+    long step = 0, first, last;
+
+    while (nextRange(data->dist, data->thread_id, data->numThreads, out->rows, &step, &first, &last)) 
+    {
+        for (long r = first; r < last; r++) 
+        {
+            const T* row = &data->dense[r * cols];
+
+            long k = out->offsets[r];
+
+            for (long c = 0; c < cols; c++) 
+            {
+                if (row[c] != T(0)) 
+                {
+                    out->indices[k] = (int) c;
+                    out->values[k] = row[c];
+                    k++;
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// Thread function for compressed → dense: scatters the outer lines dealt.
+// CSR rows are zeroed first (a row belongs to one thread); for CSC the
+// caller zeroes the whole matrix beforehand.
+template <typename T>
+void* sparseToDenseThread(void* arg) 
+{
+    SparseThreadData<T>* data = (SparseThreadData<T>*) arg;
+
+    const SparseMatrix<T>* in = data->in;
+    long cols = in->cols;
+    bool csr = (in->layout == SPARSE_CSR);
+    long step = 0, first, last;
+
+    while (nextRange(data->dist, data->thread_id, data->numThreads, outerLines(in), &step, &first, &last)) 
+    {
+        for (long line = first; line < last; line++) 
+        {
+            if (csr)
+                memset(&data->dense[line * cols], 0, cols * sizeof(T));
+
+            for (long k = in->offsets[line]; k < in->offsets[line + 1]; k++) 
+            {
+                long r = csr ? line : in->indices[k];
+                long c = csr ? in->indices[k] : line;
+
+                data->dense[r * cols + c] = in->values[k];
+            }
+        }
+    }
+
+    return NULL;
+}
+
+// Thread function for the transpose, first pass: this thread's histogram of
+// inner indices over its block of outer lines.
+template <typename T>
+void* sparseHistogramThread(void* arg) 
+{
+    SparseThreadData<T>* data = (SparseThreadData<T>*) arg;
+
+    const SparseMatrix<T>* in = data->in;
+    long* counts = &data->counts[(long) data->thread_id * innerLines(in)];
+
+    memset(counts, 0, innerLines(in) * sizeof(long));
+
+    for (long k = in->offsets[data->firstLine]; k < in->offsets[data->lastLine]; k++)
+        counts[in->indices[k]]++;
+
+    return NULL;
+}
+
+// Thread function for the transpose, second pass: for the inner lines dealt
+// (in whole cache lines of counts), each thread's count becomes its write
+// position relative to the start of the output line, and the line's total
+// entries go to out->offsets[line + 1].
+template <typename T>
+void* sparsePrefixThread(void* arg) 
+{
+    SparseThreadData<T>* data = (SparseThreadData<T>*) arg;
+
+    long inner = innerLines(data->in);
+
+    forEachLineRange<long>(data->dist, data->thread_id, data->numThreads, inner, [&](long start, long end) {
+        for (long line = start; line < end; line++) 
+        {
+            long running = 0;
+
+            for (int t = 0; t < data->numThreads; t++) 
+            {
+                long count = data->counts[t * inner + line];
+
+                data->counts[t * inner + line] = running;
+                running += count;
+            }
+
+            data->out->offsets[line + 1] = running;
+        }
+    });
+
+    return NULL;
+}
+
+// Thread function for the transpose, last pass: scatters this thread's
+// block of entries to their positions in the output lines.
+template <typename T>
+void* sparseScatterThread(void* arg) 
+{
+    SparseThreadData<T>* data = (SparseThreadData<T>*) arg;
+
+    const SparseMatrix<T>* in = data->in;
+    SparseMatrix<T>* out = data->out;
+    long* positions = &data->counts[(long) data->thread_id * innerLines(in)];
+
+    for (long line = data->firstLine; line < data->lastLine; line++) 
+    {
+        for (long k = in->offsets[line]; k < in->offsets[line + 1]; k++) 
+        {
+            int inner = in->indices[k];
+
+            long to = out->offsets[inner] + positions[inner]++;
+
+            out->indices[to] = (int) line;
+            out->values[to] = in->values[k];
+        }
+    }
+
+    return NULL;
+}
+
+// Runs one of the sparse thread functions on the pool. lineStarts (NULL for
+// the dealt passes) holds numThreads + 1 block boundaries of outer lines.
+template <typename T>
+void runSparseJob(WorkerPool* pool, void* (*task)(void*), const SparseMatrix<T>* in, SparseMatrix<T>* out, 
+                  T* dense, long* counts, const long* lineStarts, Distribution* dist)
+{
+    int numThreads = pool->numThreads;
+
+    SparseThreadData<T>* sparseData = new SparseThreadData<T>[numThreads];
+
+    resetDistribution(dist);
+
+    for (int t = 0; t < numThreads; t++) 
+    {
+        sparseData[t].thread_id = t;
+        sparseData[t].numThreads = numThreads;
+        sparseData[t].in = in;
+        sparseData[t].out = out;
+        sparseData[t].dense = dense;
+        sparseData[t].counts = counts;
+        sparseData[t].firstLine = (lineStarts != NULL) ? lineStarts[t] : 0;
+        sparseData[t].lastLine = (lineStarts != NULL) ? lineStarts[t + 1] : 0;
+        sparseData[t].dist = dist;
+    }
+
+    poolRun(pool, task, sparseData, sizeof(SparseThreadData<T>), numThreads);
+
+    delete[] sparseData;
+}
+
+// Compresses a rows×cols dense matrix into CSR (out is allocated here).
+template <typename T>
+void parallelDenseToSparse(WorkerPool* pool, const T* dense, int rows, int cols, SparseMatrix<T>* out, Distribution* dist)
+{
+    out->layout = SPARSE_CSR;
+    out->rows = rows;
+    out->cols = cols;
+    out->offsets = new long[rows + 1];
+
+    runSparseJob(pool, sparseCountRowsThread<T>, (const SparseMatrix<T>*) NULL, out, (T*) dense, (long*) NULL, 
+                 (const long*) NULL, dist);
+
+    out->offsets[0] = 0;
+
+    for (int r = 0; r < rows; r++)
+        out->offsets[r + 1] += out->offsets[r];
+
+    out->nnz = out->offsets[rows];
+    out->indices = new int[out->nnz];
+    out->values = new T[out->nnz];
+
+    runSparseJob(pool, sparseFillRowsThread<T>, (const SparseMatrix<T>*) NULL, out, (T*) dense, (long*) NULL, 
+                 (const long*) NULL, dist);
+}
+
+// Expands a CSR or CSC matrix into a rows×cols dense one.
+template <typename T>
+void parallelSparseToDense(WorkerPool* pool, const SparseMatrix<T>* in, T* dense, Distribution* dist)
+{
+    if (in->layout == SPARSE_CSC)
+        parallelEvaluate(pool, dense, (long) in->rows * in->cols, ConstantExpr<T>(T(0)), dist);
+
+    runSparseJob(pool, sparseToDenseThread<T>, in, (SparseMatrix<T>*) NULL, dense, (long*) NULL, 
+                 (const long*) NULL, dist);
+}
+
+// CSR → CSC (or CSC → CSR) of the same matrix; out is allocated here. The
+// outer lines are split into one contiguous block per thread with about the
+// same number of entries; dist deals the inner lines of the prefix pass.
+template <typename T>
+void parallelSparseTranspose(WorkerPool* pool, const SparseMatrix<T>* in, SparseMatrix<T>* out, Distribution* dist)
+{
+    int numThreads = pool->numThreads;
+
+    allocateSparse(out, (in->layout == SPARSE_CSR) ? SPARSE_CSC : SPARSE_CSR, in->rows, in->cols, in->nnz);
+
+    long outer = outerLines(in), inner = innerLines(in);
+
+    long* lineStarts = new long[numThreads + 1];
+
+    for (int t = 0; t <= numThreads; t++)
+        lineStarts[t] = lower_bound(in->offsets, in->offsets + outer, in->nnz * t / numThreads) - in->offsets;
+
+    lineStarts[numThreads] = outer;
+
+    long* counts = new long[numThreads * inner];
+
+    runSparseJob(pool, sparseHistogramThread<T>, in, out, (T*) NULL, counts, lineStarts, dist);
+    runSparseJob(pool, sparsePrefixThread<T>, in, out, (T*) NULL, counts, lineStarts, dist);
+
+    out->offsets[0] = 0;
+
+    for (long line = 0; line < inner; line++)
+        out->offsets[line + 1] += out->offsets[line];
+
+    runSparseJob(pool, sparseScatterThread<T>, in, out, (T*) NULL, counts, lineStarts, dist);
+
+    delete[] lineStarts;
+    delete[] counts;
+}
+
+// Element-wise log of the stored entries only (implicit zeros stay zero);
+// out gets the structure of in. out may be in itself.
+template <typename T>
+void parallelSparseLog(WorkerPool* pool, const SparseMatrix<T>* in, SparseMatrix<T>* out, LogAccuracy accuracy, Distribution* dist)
+{
+    if (out != in) 
+    {
+        allocateSparse(out, in->layout, in->rows, in->cols, in->nnz);
+
+        memcpy(out->offsets, in->offsets, (outerLines(in) + 1) * sizeof(long));
+        memcpy(out->indices, in->indices, in->nnz * sizeof(int));
+    }
+
+    parallelLogRange(pool, in->values, out->values, in->nnz, accuracy, dist);
+}
+
+// -----------------------------
+// Matrix Multiplication (GEMM)
+// -----------------------------
+// C = αAB + βC, blocked for the cache hierarchy (see GemmBlocking). Each work
+// unit is one MC×NC block of C; for every KC-deep slice of the inner
+// dimension the thread packs the matching panels of B (into NR-wide
+// micro-panels, row by row) and of A (into MR-tall micro-panels, column by
+// column) into its own buffers, then sweeps the MR×NR micro-kernel over the
+// block. Packing makes every micro-kernel load sequential and zero-pads the
+// edges, so the micro-kernel itself never branches on the shape. β is
+// applied with the first slice only (β = 0 never reads C, as in BLAS).
+
+// Packs rows [0, kc) × columns [0, nc) of B (stride ldb) into NR-wide
+// micro-panels: panel jr holds element (p, j) at packed[jr*kc + p*NR + j].
+// B is read row by row (walking a micro-panel down its column would touch
+// one line per row, ldb apart, and thrash the cache sets on power-of-two
+// strides).
+template <typename T>
+void gemmPackB(const T* b, long ldb, int kc, int nc, T* packed)
+{
+    const int NR = GemmBlocking<T>::NR;
+
+    for (int p = 0; p < kc; p++) 
+    {
+        const T* row = &b[(long) p * ldb];
+
+        int jr = 0;
+
+        for (; jr + NR <= nc; jr += NR) 
+        {
+            T* out = &packed[(long) jr * kc + p * NR];
+
+            for (int j = 0; j < NR; j++)
+                out[j] = row[jr + j];
+        }
+
+        if (jr < nc) 
+        {
+            T* out = &packed[(long) jr * kc + p * NR];
+
+            for (int j = 0; j < NR; j++)
+                out[j] = (jr + j < nc) ? row[jr + j] : T(0);
+        }
+    }
+}
+
+// Packs rows [0, mc) × columns [0, kc) of A (stride lda) into MR-tall
+// micro-panels: panel ir holds element (i, p) at packed[ir*kc + p*MR + i].
+template <typename T>
+void gemmPackA(const T* a, long lda, int mc, int kc, T* packed)
+{
+    const int MR = GemmBlocking<T>::MR;
+
+    for (int ir = 0; ir < mc; ir += MR) 
+    {
+        int mr = (mc - ir < MR) ? mc - ir : MR;
+
+        for (int p = 0; p < kc; p++) 
+        {
+            for (int i = 0; i < mr; i++)
+                packed[i] = a[(long) (ir + i) * lda + p];
+
+            for (int i = mr; i < MR; i++)
+                packed[i] = T(0);
+
+            packed += MR;
+        }
+    }
+}
+
+// The register-tiled kernel: an MR×NR tile of C (stride ldc) becomes
+// α · (packed A micro-panel × packed B micro-panel) + β · C. Each step of
+// the kc loop broadcasts MR elements of A against two vectors of B.
+template <typename T>
+inline void gemmMicroKernel(int kc, const T* a, const T* b, T alpha, T beta, T* c, long ldc)
+{
+    const int MR = GemmBlocking<T>::MR, NR = GemmBlocking<T>::NR;
+    const int W = SimdVec<T>::WIDTH;
+
+    SimdVec<T> c0[MR], c1[MR];
+
+    #pragma GCC unroll 8
+    for (int i = 0; i < MR; i++)
+        c0[i] = c1[i] = SimdVec<T>(T(0));
+
+    for (int p = 0; p < kc; p++) 
+    {
+        SimdVec<T> b0 = simdLoad(b), b1 = simdLoad(b + W);
+
+        #pragma GCC unroll 8
+        for (int i = 0; i < MR; i++) 
+        {
+            SimdVec<T> ai(a[i]);
+
+            c0[i] = simdFma(ai, b0, c0[i]);
+            c1[i] = simdFma(ai, b1, c1[i]);
+        }
+
+        a += MR;
+        b += NR;
+    }
+
+    SimdVec<T> va(alpha), vb(beta);
+
+    #pragma GCC unroll 8
+    for (int i = 0; i < MR; i++) 
+    {
+        T* row = c + i * ldc;
+
+        if (beta == T(0)) 
+        {
+            simdStore(row, va * c0[i]);
+            simdStore(row + W, va * c1[i]);
+        }
+        else 
+        {
+            simdStore(row, simdFma(vb, simdLoad(row), va * c0[i]));
+            simdStore(row + W, simdFma(vb, simdLoad(row + W), va * c1[i]));
+        }
+    }
+}
+
+// Computes one mc×nc block of C from packed panels of depth kc: full tiles
+// go straight to C, edge tiles through a small buffer.
+template <typename T>
+void gemmMacroKernel(int mc, int nc, int kc, const T* packedA, const T* packedB, T alpha, T beta, T* c, long ldc)
+{
+    const int MR = GemmBlocking<T>::MR, NR = GemmBlocking<T>::NR;
+
+    T edge[MR * NR];
+
+    for (int jr = 0; jr < nc; jr += NR) 
+    {
+        int nr = (nc - jr < NR) ? nc - jr : NR;
+
+        for (int ir = 0; ir < mc; ir += MR) 
+        {
+            int mr = (mc - ir < MR) ? mc - ir : MR;
+
+            const T* a = &packedA[(long) ir * kc];
+            const T* b = &packedB[(long) jr * kc];
+            T* tile = &c[(long) ir * ldc + jr];
+
+            if (mr == MR && nr == NR) 
+            {
+                gemmMicroKernel(kc, a, b, alpha, beta, tile, ldc);
+
+                continue;
+            }
+
+            gemmMicroKernel(kc, a, b, alpha, T(0), edge, NR);
+
+            for (int i = 0; i < mr; i++) 
+            {
+                for (int j = 0; j < nr; j++) 
+                {
+                    T* out = &tile[(long) i * ldc + j];
+
+                    *out = (beta == T(0)) ? edge[i * NR + j] : edge[i * NR + j] + beta * *out;
+                }
+            }
+        }
+    }
+}
+
+// Thread function for matrix multiplication. The MC×NC blocks of C are
+// numbered down each block column first, so consecutive blocks of a thread
+// reuse the same panels of B from the shared cache.
+template <typename T>
+void* gemmThread(void* arg) 
+{
+    GemmThreadData<T>* data = (GemmThreadData<T>*) arg;
+
+    const int MC = GemmBlocking<T>::MC, NC = GemmBlocking<T>::NC, KC = GemmBlocking<T>::KC;
+    const int MR = GemmBlocking<T>::MR, NR = GemmBlocking<T>::NR;
+
+    int m = data->m, n = data->n, k = data->k;
+
+    int blockRows = (m + MC - 1) / MC;
+    int blockCols = (n + NC - 1) / NC;
+
+    // Packing buffers, allocated (and so first touched) by the thread using them.
+    T* packedA = new T[(long) (MC + MR) * KC];
+    T* packedB = new T[(long) (NC + NR) * KC];
+
+    long step = 0, first, last;
+
+    while (nextRange(data->dist, data->thread_id, data->numThreads, (long) blockRows * blockCols, &step, &first, &last)) 
+    {
+        for (long unit = first; unit < last; unit++) 
+        {
+            int ic = (unit % blockRows) * MC, jc = (unit / blockRows) * NC;
+            int mc = (m - ic < MC) ? m - ic : MC;
+            int nc = (n - jc < NC) ? n - jc : NC;
+
+            T* c = &data->c[(long) ic * data->ldc + jc];
+
+            for (int pc = 0; pc < k; pc += KC) 
+            {
+                int kc = (k - pc < KC) ? k - pc : KC;
+
+                gemmPackB(&data->b[(long) pc * data->ldb + jc], data->ldb, kc, nc, packedB);
+                gemmPackA(&data->a[(long) ic * data->lda + pc], data->lda, mc, kc, packedA);
+
+                gemmMacroKernel(mc, nc, kc, packedA, packedB, data->alpha, (pc == 0) ? data->beta : T(1), c, data->ldc);
+            }
+
+            // k = 0: the product is empty and only C = βC remains.
+            if (k == 0) 
+            {
+                for (int i = 0; i < mc; i++)
+                    for (int j = 0; j < nc; j++)
+                        c[(long) i * data->ldc + j] = (data->beta == T(0)) ? T(0) : data->beta * c[(long) i * data->ldc + j];
+            }
+        }
+    }
+
+    delete[] packedA;
+    delete[] packedB;
+
+    return NULL;
+}
+
+// C = αAB + βC on the pool, A m×k, B k×n, C m×n, all row-major with the
+// given leading dimensions (C must not overlap A or B).
+template <typename T>
+void parallelGemm(WorkerPool* pool, int m, int n, int k, T alpha, const T* a, long lda, const T* b, long ldb, 
+                  T beta, T* c, long ldc, Distribution* dist)
+{
+    int numThreads = pool->numThreads;
+
+    GemmThreadData<T>* gemmData = new GemmThreadData<T>[numThreads];
+
+    resetDistribution(dist);
+
+    for (int t = 0; t < numThreads; t++) 
+    {
+        gemmData[t].thread_id = t;
+        gemmData[t].numThreads = numThreads;
+        gemmData[t].m = m;
+        gemmData[t].n = n;
+        gemmData[t].k = k;
+        gemmData[t].alpha = alpha;
+        gemmData[t].beta = beta;
+        gemmData[t].a = a;
+        gemmData[t].lda = lda;
+        gemmData[t].b = b;
+        gemmData[t].ldb = ldb;
+        gemmData[t].c = c;
+        gemmData[t].ldc = ldc;
+        gemmData[t].dist = dist;
+    }
+
+    poolRun(pool, gemmThread<T>, gemmData, sizeof(GemmThreadData<T>), numThreads);
+
+    delete[] gemmData;
+}
+
+} // namespace
+
+#endif